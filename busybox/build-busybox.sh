@@ -32,9 +32,9 @@ fi
 
 cd "busybox-${BB_VER}"
 
-# Use provided defconfig
+# Use provided defconfig, only when it changed (.config.solix is the last copy)
 if [[ -f "${SCRIPT_DIR}/busybox.config" ]]; then
-  cp "${SCRIPT_DIR}/busybox.config" .config
+  cmp -s "${SCRIPT_DIR}/busybox.config" .config.solix || { cp "${SCRIPT_DIR}/busybox.config" .config; cp "${SCRIPT_DIR}/busybox.config" .config.solix; }
 else
   echo "Missing busybox.config at ${SCRIPT_DIR}/busybox.config" >&2
   exit 1
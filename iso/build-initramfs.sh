@@ -1,24 +1,37 @@
 #!/usr/bin/env bash
 set -euo pipefail
 
-# Usage: build-initramfs.sh <BUILD_DIR_ABS> <BUSYBOX_INSTALL_ABS> <ROOTFS_SRC_ABS>
+# Usage: build-initramfs.sh <BUILD_DIR_ABS> <BUSYBOX_INSTALL_ABS> <ROOTFS_SRC_ABS> [gzip|zstd|lz4|none]
+# The compressor must match a CONFIG_RD_* option enabled in kernel/config.
 
 BUILD_DIR="${1:?BUILD_DIR required}"
 BB_INSTALL="${2:?BUSYBOX_INSTALL path required}"
 ROOTFS_SRC="${3:?ROOTFS_SRC path required}"
+COMP="${4:-${INITRAMFS_COMP:-zstd}}"
 
 WORKDIR="${BUILD_DIR}/initramfs-root"
 INITRD="${BUILD_DIR}/initramfs.img"
+# Uncompressed archive of the last build, kept to detect no-op rebuilds
+CPIO_CACHE="${BUILD_DIR}/initramfs.cpio"
+SOURCE_DATE_EPOCH="${SOURCE_DATE_EPOCH:-0}"
 
-rm -rf "${WORKDIR}"
-mkdir -p "${WORKDIR}"/{bin,sbin,etc,proc,sys,dev,tmp,usr/bin,root,home}
-
-# Copy BusyBox and create sh symlink
+# Copy BusyBox and create sh symlink. The staging tree is kept between
+# builds: rsync --checksum only rewrites what changed (mtimes are reset
+# below, so they cannot be compared) and --delete drops stale BusyBox
+# files. The P filters keep --delete off what this script adds itself;
+# those are written below with install -C, which leaves an identical file
+# alone.
 if [[ ! -x "${BB_INSTALL}/bin/busybox" ]]; then
   echo "BusyBox not found at ${BB_INSTALL}/bin/busybox" >&2
   exit 1
 fi
-rsync -a "${BB_INSTALL}/" "${WORKDIR}/"
+mkdir -p "${WORKDIR}"
+rsync -a --delete --checksum \
+  --filter='P /init' --filter='P /etc/***' --filter='P /dev/***' \
+  --filter='P /proc/***' --filter='P /sys/***' --filter='P /tmp/***' --filter='P /root/***' --filter='P /home/***' \
+  --filter='P /bin/shell' --filter='P /bin/*_lite' \
+  "${BB_INSTALL}/" "${WORKDIR}/"
+mkdir -p "${WORKDIR}"/{bin,sbin,etc,proc,sys,dev,tmp,usr/bin,root,home}
 ln -sf /bin/busybox "${WORKDIR}/bin/sh"
 
 # Create minimal device nodes expected early (best-effort; may fail in containers)
@@ -27,34 +40,76 @@ mknod -m 666 "${WORKDIR}/dev/null" c 1 3 2>/dev/null || true
 
 # Init script: use user's rcS as PID1 via /init
 install -d "${WORKDIR}/etc/init.d"
-install -m 0755 "${ROOTFS_SRC}/etc/init.d/rcS" "${WORKDIR}/etc/init.d/rcS"
-cat > "${WORKDIR}/init" << 'EOF'
+install -C -m 0755 "${ROOTFS_SRC}/etc/init.d/rcS" "${WORKDIR}/etc/init.d/rcS"
+cat > "${WORKDIR}/init.new" << 'EOF'
 #!/bin/sh
 echo "[initramfs] Solix early init"
 mount -t proc proc /proc
+read -r SOLIX_T_INIT _ < /proc/uptime && export SOLIX_T_INIT
 mount -t sysfs sysfs /sys
 mount -t devtmpfs devtmpfs /dev 2>/dev/null || true
 exec /etc/init.d/rcS
 EOF
-chmod +x "${WORKDIR}/init"
+install -C -m 0755 "${WORKDIR}/init.new" "${WORKDIR}/init"
+rm -f "${WORKDIR}/init.new"
 
-# Include custom static shell
+# Include custom static shell; the *_lite utilities are applets inside it
 if [[ -x "${BUILD_DIR}/rootfs/bin/shell" ]]; then
-  install -D -m 0755 "${BUILD_DIR}/rootfs/bin/shell" "${WORKDIR}/bin/shell"
+  install -C -D -m 0755 "${BUILD_DIR}/rootfs/bin/shell" "${WORKDIR}/bin/shell"
+  for u in uptime_lite ps_lite meminfo_lite top_lite; do
+    ln -sf shell "${WORKDIR}/bin/${u}"
+  done
 fi
 
 # Include minimal udhcpc script for DHCP
 if [[ -f "${ROOTFS_SRC}/etc/udhcpc.script" ]]; then
-  install -D -m 0755 "${ROOTFS_SRC}/etc/udhcpc.script" "${WORKDIR}/etc/udhcpc.script"
+  install -C -D -m 0755 "${ROOTFS_SRC}/etc/udhcpc.script" "${WORKDIR}/etc/udhcpc.script"
 fi
 
 # Optional network bring-up helper
 if [[ -f "${ROOTFS_SRC}/etc/network.up" ]]; then
-  install -D -m 0755 "${ROOTFS_SRC}/etc/network.up" "${WORKDIR}/etc/network.up"
+  install -C -D -m 0755 "${ROOTFS_SRC}/etc/network.up" "${WORKDIR}/etc/network.up"
 fi
 
-# Create archive
+# Compressor: multithreaded where the tool allows it. zstd and lz4 cost
+# more bytes than gzip -9 but decompress several times faster at boot
+# (zstd's level only affects build time, not decompression speed).
+compress() {
+  case "${COMP}" in
+    zstd) zstd -q -T0 -19 -c ;;
+    lz4)  lz4 -q -l -9 -c ;;          # the kernel only reads the legacy lz4 frame
+    gzip) if command -v pigz >/dev/null 2>&1; then pigz -9 -n -c; else gzip -9 -n -c; fi ;;
+    none) cat ;;
+  esac
+}
+
+case "${COMP}" in
+  gzip|none) ;;
+  zstd|lz4)
+    if ! command -v "${COMP}" >/dev/null 2>&1; then
+      echo "[initramfs] ${COMP} not found; falling back to gzip" >&2
+      COMP=gzip
+    fi
+    ;;
+  *) echo "Unknown INITRAMFS_COMP=${COMP} (gzip|zstd|lz4|none)" >&2; exit 1 ;;
+esac
+
+# Create archive: fixed mtimes, sorted names, root ownership and no inode
+# numbers, so unchanged inputs give a byte-identical cpio
 cd "${WORKDIR}"
-find . -print0 | cpio --null -ov --format=newc | gzip -9 > "${INITRD}"
-echo "Created initramfs: ${INITRD}"
+find . -exec touch -h -d "@${SOURCE_DATE_EPOCH}" {} +
+find . -print0 | LC_ALL=C sort -z | cpio --null -o --format=newc --reproducible -R 0:0 --quiet > "${CPIO_CACHE}.new"
+
+# Same archive and compressor as last time: keep the compressed image
+if [[ -f "${INITRD}" && "$(cat "${INITRD}.comp" 2>/dev/null)" == "${COMP}" ]] && cmp -s "${CPIO_CACHE}.new" "${CPIO_CACHE}"; then
+  rm -f "${CPIO_CACHE}.new"
+  touch "${INITRD}"
+  echo "Initramfs unchanged: ${INITRD}"
+  exit 0
+fi
+compress < "${CPIO_CACHE}.new" > "${INITRD}.new"
+mv "${INITRD}.new" "${INITRD}"
+mv "${CPIO_CACHE}.new" "${CPIO_CACHE}"
+echo "${COMP}" > "${INITRD}.comp"
+echo "Created initramfs: ${INITRD} (${COMP}, $(stat -c %s "${INITRD}") bytes)"
 
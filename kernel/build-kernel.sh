@@ -1,13 +1,19 @@
 #!/usr/bin/env bash
 set -euo pipefail
 
-# Usage: build-kernel.sh <KERNEL_VER> <BUILD_DIR_ABS>
+# Usage: build-kernel.sh <KERNEL_VER> <BUILD_DIR_ABS> [PROFILE]
 # Downloads and builds a real Linux kernel bzImage using provided config.
+# PROFILE (default: default) appends kernel/config.<PROFILE> to kernel/config;
+# each profile builds in its own object tree, so switching is incremental.
 
 KERNEL_VER="${1:-6.6.8}"
 BUILD_DIR="${2:-$(pwd)/../build}"
+PROFILE="${3:-default}"
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
 
+SUFFIX="-solix"
+[[ "${PROFILE}" == "default" ]] || SUFFIX="-solix-${PROFILE}"
+
 KERNEL_TARBALL="linux-${KERNEL_VER}.tar.xz"
 KERNEL_URLS=(
   "https://cdn.kernel.org/pub/linux/kernel/v6.x/${KERNEL_TARBALL}"
@@ -37,30 +43,54 @@ if [[ ! -d "linux-${KERNEL_VER}" ]]; then
 fi
 
 cd "linux-${KERNEL_VER}"
+OBJ_DIR="${SCRIPT_DIR}/downloads/obj-${KERNEL_VER}-${PROFILE}"
+mkdir -p "${OBJ_DIR}"
 
-# Apply provided config
-if [[ -f "${SCRIPT_DIR}/config" ]]; then
-  cp "${SCRIPT_DIR}/config" .config
-else
+# Out-of-tree builds need a clean source tree (older in-tree builds left one)
+if [[ -f .config ]]; then
+  echo "Cleaning in-tree kernel build for out-of-tree profiles..."
+  make mrproper
+fi
+
+# Assemble the profile config
+if [[ ! -f "${SCRIPT_DIR}/config" ]]; then
   echo "Missing kernel config at ${SCRIPT_DIR}/config" >&2
   exit 1
 fi
+FRAGMENTS=("${SCRIPT_DIR}/config")
+if [[ "${PROFILE}" != "default" ]]; then
+  if [[ ! -f "${SCRIPT_DIR}/config.${PROFILE}" ]]; then
+    echo "Unknown kernel profile ${PROFILE}: missing ${SCRIPT_DIR}/config.${PROFILE}" >&2
+    exit 1
+  fi
+  FRAGMENTS+=("${SCRIPT_DIR}/config.${PROFILE}")
+fi
+
+# Apply it only when it changed; olddefconfig rewrites .config,
+# so .config.solix remembers the copy we last applied
+cat "${FRAGMENTS[@]}" > "${OBJ_DIR}/.config.new"
+if cmp -s "${OBJ_DIR}/.config.new" "${OBJ_DIR}/.config.solix"; then
+  rm -f "${OBJ_DIR}/.config.new"
+else
+  cp "${OBJ_DIR}/.config.new" "${OBJ_DIR}/.config"
+  mv "${OBJ_DIR}/.config.new" "${OBJ_DIR}/.config.solix"
+fi
 
-echo "Preparing kernel config (olddefconfig)..."
-make olddefconfig
+echo "Preparing kernel config (olddefconfig, profile ${PROFILE})..."
+make O="${OBJ_DIR}" olddefconfig
 
 JOBS=${JOBS:-$(nproc 2>/dev/null || sysctl -n hw.ncpu 2>/dev/null || echo 2)}
 echo "Building bzImage with -j${JOBS}..."
-make -j"${JOBS}" bzImage
+make O="${OBJ_DIR}" -j"${JOBS}" bzImage
 
 # Install artifacts
-cp arch/x86/boot/bzImage "${BUILD_DIR}/boot/vmlinuz-${KERNEL_VER}-solix"
-cp System.map "${BUILD_DIR}/boot/System.map-${KERNEL_VER}-solix" || true
+cp "${OBJ_DIR}/arch/x86/boot/bzImage" "${BUILD_DIR}/boot/vmlinuz-${KERNEL_VER}${SUFFIX}"
+cp "${OBJ_DIR}/System.map" "${BUILD_DIR}/boot/System.map-${KERNEL_VER}${SUFFIX}" || true
 
 pushd "${BUILD_DIR}/boot" >/dev/null
-ln -sf "vmlinuz-${KERNEL_VER}-solix" vmlinuz
-ln -sf "System.map-${KERNEL_VER}-solix" System.map || true
+ln -sf "vmlinuz-${KERNEL_VER}${SUFFIX}" vmlinuz
+ln -sf "System.map-${KERNEL_VER}${SUFFIX}" System.map || true
 popd >/dev/null
 
-echo "Kernel installed to ${BUILD_DIR}/boot/vmlinuz-${KERNEL_VER}-solix"
+echo "Kernel installed to ${BUILD_DIR}/boot/vmlinuz-${KERNEL_VER}${SUFFIX}"
 
@@ -7,17 +7,31 @@
  *
  * A small but capable static shell
  * Features now include:
- * - Prompt: username@hostname:cwd$ (cwd truncated to last 2 segments)
- * - History: in-memory + persistent at ~/.solix_history
+ * - Prompt: rendered from PS1 (default username@hostname:cwd$, cwd truncated
+ *   to last 2 segments) and cached until cd/export/unset/hostname change it
+ * - History: compact in-memory ring + append-only ~/.solix_history
  * - Built-ins: cd, pwd, echo, help, exit, history, which, export, unset
- * - PATH lookup for external commands
+ * - PATH lookup for external commands, cached in a command hash (see: hash)
+ * - External commands launched via posix_spawn (fork fallback)
  * - Redirections: >, >>, < (single redirection per command side)
- * - Pipe: single pipeline cmd1 | cmd2
- * - Chaining: cmd1 && cmd2, cmd1 || cmd2, cmd1 ; cmd2
- * - Exit status tracking: $? expansion
- * - Signals: foreground job receives SIGINT; shell survives
+ * - Pipelines: cmd1 | cmd2 | ... | cmdN (optional pipefail via set -o pipefail)
+ * - Chaining: cmd1 && cmd2, cmd1 || cmd2, cmd1 ; cmd2 (&&/|| short-circuit)
+ * - Exit status tracking: $? expansion, per command
+ * - Lines are lexed into typed tokens and parsed once into a command list;
+ *   parsed lines are cached, so repeated lines skip both steps
+ * - Jobs: cmd &, jobs, fg, bg, wait, $!; each job in its own process group
+ *   so SIGINT/SIGTSTP from the terminal reach only the foreground job
+ * - Signals: shell survives SIGINT; SIGCHLD reaper records exit statuses
+ * - parallel [-j N] cmd {} ::: items: bounded worker pool over the spawn path
+ * - time prefix (wall, user/sys, max RSS, faults via wait4 rusage);
+ *   SOLIX_PROFILE=1 logs every command's timings to SOLIX_PROFILE_FILE
+ * - Multi-call binary: the *_lite utilities are linked in as applets,
+ *   run in-process as builtins or via a symlink's argv[0] (BusyBox-style)
+ * - Per-line parse state lives in a bump arena reset once per line
+ * - Non-interactive modes: shell -c "cmd" [name args...], shell file.sh [args...]
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,45 +44,258 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <time.h>
+#include <spawn.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "../utils/applets.h"
+
+extern char **environ;
 
 // Configuration constants
-#define MAX_CMD_LEN 1024
 #define MAX_ARGS 64
 #define MAX_PATH_LEN 512
 #define HISTORY_SIZE 200
+#define HISTORY_BUF_SIZE 32768
+#define HISTORY_FILE_MAX 65536
 #define PROMPT_COLOR "\033[1;32m"
 #define ERROR_COLOR "\033[1;31m"
 #define INFO_COLOR "\033[1;34m"
 #define RESET_COLOR "\033[0m"
-#define MAX_TOKENS 128
+#define CMD_HASH_BUCKETS 64
+#define PARSE_CACHE_SIZE 64
+#define BUILTIN_SLOTS 256
+#define ARENA_CHUNK_SIZE 65536
+#define SCRIPT_BUF_SIZE 65536
+#define CAT_BUF_SIZE 65536
+#define CAT_CHUNK_MAX (1 << 30)
+#define LS_DENT_BUF 65536
+#define OUT_BUF_SIZE 65536
+#define DEFAULT_PS1 "\\u@\\h:\\w$ "
+#define CHLD_QUEUE_SIZE 64
+#define PARALLEL_MAX_JOBS 256
+#define DEFAULT_PROFILE_FILE "/tmp/solix_profile.log"
 
 // Global variables
-static char command_history[HISTORY_SIZE][MAX_CMD_LEN];
-static int history_count = 0;
+// History ring: variable-length entries packed into history_buf
+struct history_entry
+{
+    unsigned off;
+    unsigned len;
+};
+static char history_buf[HISTORY_BUF_SIZE];
+static struct history_entry history_ents[HISTORY_SIZE];
+static int history_first = 0; // slot of the oldest entry
+static int history_len = 0;   // entries currently held
+static size_t history_head = 0; // next write offset in history_buf
+static int history_count = 0; // entries added since startup (numbering)
+static int history_fd = -1;
+static size_t history_file_size = 0;
 static int history_index = 0;
 static volatile sig_atomic_t running = 1;
 static int last_status = 0;
 static char history_path[512];
+static int interactive = 1;
+static char **script_args = NULL; // $0, $1, ... in script and -c modes
+static int script_nargs = 0;
+static char out_buf[OUT_BUF_SIZE];
+static size_t out_len = 0;
+static char prompt_cache[1024];
+static size_t prompt_cache_len = 0;
+static int prompt_dirty = 1;
+static int opt_pipefail = 0;
+static int opt_spawn = 1;
+
+// Bump arena for per-line parse memory (tokens, argv arrays, redirection targets)
+struct arena_chunk
+{
+    struct arena_chunk *next;
+    size_t cap;
+    size_t used;
+    char data[];
+};
+static struct arena_chunk *arena_head = NULL;
+static struct arena_chunk *arena_cur = NULL;
+
+// Buffered reader for script input: one read() serves many lines
+struct line_reader
+{
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t pos;
+    size_t len;
+    int eof;
+};
+
+// Command hash entry: resolved absolute path for a command name
+struct cmd_hash_entry
+{
+    char *name;
+    char *path;
+    int hits;
+    struct cmd_hash_entry *next;
+};
+static struct cmd_hash_entry *cmd_hash[CMD_HASH_BUCKETS];
+
+// Options toggled by the set builtin
+static struct
+{
+    const char *name;
+    int *flag;
+} shell_options[] = {
+    {"pipefail", &opt_pipefail},
+    {"spawn", &opt_spawn},
+    {NULL, NULL}};
+
+// One stage of a pipeline: argv plus its own redirections
+// In a parsed line, expand (NULL if nothing to do) flags the argv words
+// to $-expand when the stage runs; redir_expand does the same for the
+// redirection targets (EXPAND_IN, EXPAND_OUT).
+struct stage
+{
+    char **argv;
+    const char *in_file;
+    const char *out_file;
+    int append;
+    const unsigned char *expand;
+    unsigned char redir_expand;
+};
+#define EXPAND_IN 1
+#define EXPAND_OUT 2
+
+// Lexer output: operators keep their identity, so a quoted "|" is a word
+enum tok_type
+{
+    TOK_WORD,
+    TOK_PIPE,
+    TOK_AND,
+    TOK_OR,
+    TOK_SEMI,
+    TOK_BG,
+    TOK_REDIR_IN,       // redirections last: the parser tests >= TOK_REDIR_IN
+    TOK_REDIR_OUT,
+    TOK_REDIR_APPEND
+};
+
+struct token
+{
+    enum tok_type type;
+    int expand;          // WORD starting with an unquoted or "-quoted $
+    char *text;          // WORD only
+};
+
+// One pipeline of a parsed line and the operator that ends it
+struct command
+{
+    struct stage *stages;
+    int nstages;
+    enum tok_type connector; // TOK_SEMI (also at end of line), TOK_AND, TOK_OR, TOK_BG
+    int timed;               // leading time: measure the whole pipeline
+    int empty;               // a stage has no command word: nothing runs
+    int expand;              // some stage has words to expand
+};
+
+// A parsed line in one allocation: commands, stages, argv slots, expand
+// flags, word text and the line itself back to back
+struct cmd_list
+{
+    const char *line;
+    int ncmds;
+    struct command cmds[];
+};
+static struct cmd_list *parse_cache[PARSE_CACHE_SIZE];
+
+// Jobs: one per launched command or pipeline
+#define PROC_RUNNING 0
+#define PROC_STOPPED 1
+#define PROC_DONE 2
+struct job_proc
+{
+    pid_t pid;
+    int state;
+    int status; // exit status once done, 128+signal while stopped
+    struct rusage ru; // from wait4 once done
+};
+struct job
+{
+    int id;
+    pid_t pgid;
+    int foreground;
+    int worker; // run by a builtin (parallel): never owns the terminal
+    int notify; // state changed since last reported
+    int nprocs;
+    char *cmd;
+    struct job *next;
+    struct job_proc procs[];
+};
+static struct job *job_list = NULL;
+static int job_control = 0;
+static pid_t shell_pgid = 0;
+static struct termios shell_tmodes;
+static pid_t last_bg_pid = 0;
+
+// Child status changes queued by the SIGCHLD handler, drained with SIGCHLD blocked
+static struct
+{
+    pid_t pid;
+    int status;
+    struct rusage ru;
+} chld_queue[CHLD_QUEUE_SIZE];
+static volatile sig_atomic_t chld_queue_len = 0;
+static volatile sig_atomic_t got_sigint = 0;
+
+// Usage of finished foreground (and waited-for) jobs, summed; ru_maxrss is the peak
+static struct rusage child_ru;
+
+// Snapshot taken before a timed command; see timer_start/timer_stop
+struct cmd_timer
+{
+    struct timespec wall;
+    struct rusage self;
+    struct rusage child;
+    long saved_maxrss;
+};
+struct cmd_times
+{
+    double real, user, sys;
+    long maxrss, majflt, minflt;
+};
+static int profile_fd = -1; // SOLIX_PROFILE=1: per-command timings log
 
 // Function prototypes
 void print_banner(void);
 void print_prompt(void);
 char *read_command(void);
-int tokenize_command(const char *line, char *tokens[], int max_tokens);
-void free_tokens(char *tokens[], int count);
-void expand_vars(char *tokens[], int count);
-int is_builtin(const char *cmd);
-int exec_builtin(char *const argv[]);
+void *arena_alloc(size_t size);
+char *arena_strdup(const char *str);
+void arena_reset(void);
+void out_flush(void);
+void out_write(const char *str, size_t len);
+void out_puts(const char *str);
+void out_printf(const char *fmt, ...);
+int tokenize_command(const char *line, struct token **tokens_out);
+struct cmd_list *parse_line(const char *line);
+typedef int (*builtin_fn)(char **args);
+builtin_fn find_builtin(const char *name);
 int exec_external(char *const argv[], int in_fd, int out_fd);
 int exec_simple(char *const argv[], const char *in_file, const char *out_file, int append);
-int exec_pipeline(char *const left_argv[], const char *left_in, char *const right_argv[], const char *right_out, int append);
-int execute_line_tokens(char *tokens[], int count);
+int exec_pipeline(struct stage *stages, int n, int background);
+int execute_list(const struct cmd_list *list);
+int run_line(const char *line);
+int run_script(struct line_reader *reader);
 void add_to_history(const char *command);
 void print_history(void);
 void signal_handler(int sig);
 void setup_signals(void);
 void load_history(void);
-void save_history(void);
+void compact_history(void);
 
 // Built-in command prototypes
 int builtin_cd(char **args);
@@ -80,10 +307,19 @@ int builtin_echo(char **args);
 int builtin_ls(char **args);
 int builtin_cat(char **args);
 int builtin_history(char **args);
-int builtin_uptime(char **args);
+int builtin_applet(char **args);
+int exec_applet_redir(char *const argv[], int in_fd, int out_fd);
 int builtin_which(char **args);
 int builtin_export(char **args);
 int builtin_unset(char **args);
+int builtin_set(char **args);
+int builtin_hash(char **args);
+int builtin_jobs(char **args);
+int builtin_fg(char **args);
+int builtin_bg(char **args);
+int builtin_wait(char **args);
+int builtin_time(char **args);
+int builtin_parallel(char **args);
 
 // Built-in commands table
 struct
@@ -98,271 +334,1278 @@ struct
     {"exit", builtin_exit, "Exit the shell"},
     {"clear", builtin_clear, "Clear the screen"},
     {"echo", builtin_echo, "Display text"},
-    {"ls", builtin_ls, "List directory contents"},
+    {"ls", builtin_ls, "List directory contents: ls [-a] [-l] [-F] [path...]"},
     {"cat", builtin_cat, "Display file contents"},
     {"history", builtin_history, "Show command history"},
-    {"uptime", builtin_uptime, "Show system uptime"},
+    {"uptime", builtin_applet, "Show system uptime"},
     {"which", builtin_which, "Locate a command in PATH"},
     {"export", builtin_export, "Export environment variable: export VAR=value"},
     {"unset", builtin_unset, "Unset environment variable"},
+    {"set", builtin_set, "Shell options: set -o|+o pipefail|spawn"},
+    {"hash", builtin_hash, "Command path cache: hash [-r] [name...]"},
+    {"jobs", builtin_jobs, "List background and stopped jobs"},
+    {"fg", builtin_fg, "Resume a job in the foreground: fg [%N]"},
+    {"bg", builtin_bg, "Resume a stopped job in the background: bg [%N]"},
+    {"wait", builtin_wait, "Wait for background jobs: wait [%N|pid...]"},
+    {"time", builtin_time, "Time a command or pipeline: time cmd [| cmd...]"},
+    {"parallel", builtin_parallel, "Run cmd per item: parallel [-j N] cmd [{}...] [::: item...]"},
+    {"uptime_lite", builtin_applet, "Show system uptime"},
+    {"ps_lite", builtin_applet, "List processes: ps_lite [--sort key] [--top N]"},
+    {"meminfo_lite", builtin_applet, "Memory report: meminfo_lite [-a|-f keys] [-k|-j] [-w s]"},
+    {"top_lite", builtin_applet, "Live process monitor: top_lite [-d s] [-n N]"},
     {NULL, NULL, NULL}};
 
+// Perfect hash over builtin_commands[]: slot -> table index + 1 (0: empty)
+static unsigned char builtin_slots[BUILTIN_SLOTS];
+static unsigned builtin_seed;
+
+/**
+ * Shell output buffer
+ * Builtins, the banner and the prompt write here instead of stdio; the
+ * buffer is written out only at explicit flush points (prompt wait,
+ * before fork/exec or direct fd output, and on exit) or when it fills.
+ */
+static int write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = write(fd, buf, len);
+        if (w < 0) { if (errno == EINTR) continue; return -1; }
+        buf += w; len -= (size_t)w;
+    }
+    return 0;
+}
+
+void out_flush(void)
+{
+    if (out_len) write_all(STDOUT_FILENO, out_buf, out_len);
+    out_len = 0;
+}
+
+void out_write(const char *str, size_t len)
+{
+    if (out_len + len > sizeof(out_buf)) out_flush();
+    if (len > sizeof(out_buf)) { write_all(STDOUT_FILENO, str, len); return; }
+    memcpy(out_buf + out_len, str, len);
+    out_len += len;
+}
+
+void out_puts(const char *str)
+{
+    out_write(str, strlen(str));
+}
+
+void out_printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(out_buf + out_len, sizeof(out_buf) - out_len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n < sizeof(out_buf) - out_len) { out_len += (size_t)n; return; }
+    // did not fit: format into the arena and append from there
+    char *tmp = arena_alloc((size_t)n + 1);
+    va_start(ap, fmt);
+    vsnprintf(tmp, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    out_write(tmp, (size_t)n);
+}
+
+/**
+ * writev every iovec, continuing after partial writes
+ */
+static int writev_all(int fd, struct iovec *iov, int cnt)
+{
+    while (cnt > 0) {
+        ssize_t w = writev(fd, iov, cnt > IOV_MAX ? IOV_MAX : cnt);
+        if (w < 0) { if (errno == EINTR) continue; return -1; }
+        while (cnt > 0 && (size_t)w >= iov->iov_len) { w -= (ssize_t)iov->iov_len; iov++; cnt--; }
+        if (cnt > 0) { iov->iov_base = (char *)iov->iov_base + w; iov->iov_len -= (size_t)w; }
+    }
+    return 0;
+}
+
 /**
  * Print the Solix shell banner
  */
 void print_banner(void)
 {
-    printf("%s", INFO_COLOR);
-    printf("╔══════════════════════════════════════════════════════════════╗\n");
-    printf("║                     Solix Custom Shell                      ║\n");
-    printf("║                Version 1.0 - Handcrafted                    ║\n");
-    printf("║                                                              ║\n");
-    printf("║  Built-in commands: cd, pwd, ls, cat, echo, help, exit      ║\n");
-    printf("║  Type 'help' for more information                           ║\n");
-    printf("╚══════════════════════════════════════════════════════════════╝\n");
-    printf("%s\n", RESET_COLOR);
+    out_printf("%s", INFO_COLOR);
+    out_puts("╔══════════════════════════════════════════════════════════════╗\n");
+    out_puts("║                     Solix Custom Shell                      ║\n");
+    out_puts("║                Version 1.0 - Handcrafted                    ║\n");
+    out_puts("║                                                              ║\n");
+    out_puts("║  Built-in commands: cd, pwd, ls, cat, echo, help, exit      ║\n");
+    out_puts("║  Type 'help' for more information                           ║\n");
+    out_puts("╚══════════════════════════════════════════════════════════════╝\n");
+    out_printf("%s\n", RESET_COLOR);
 }
 
 /**
  * Print the command prompt
+ * The prompt is rendered from PS1 once and cached; cd, export/unset of
+ * USER or PS1, and running `hostname` mark it stale. PS1 escapes:
+ * \u user, \h host (short), \H host, \w cwd (last 2 segments), \W cwd
+ * basename, \$ '#' for root else '$', \n newline, \\ backslash.
  */
-void print_prompt(void)
+static void prompt_append(size_t *len, const char *str)
 {
-    char cwd[MAX_PATH_LEN];
-    char hostname[256];
+    size_t n = strlen(str);
+    if (*len + n >= sizeof(prompt_cache)) n = sizeof(prompt_cache) - 1 - *len;
+    memcpy(prompt_cache + *len, str, n);
+    *len += n;
+}
+
+static void build_prompt(void)
+{
+    char cwd[MAX_PATH_LEN] = "", hostname[256] = "", chr[2] = {0, 0};
+    int have_cwd = 0, have_host = 0;
+    const char *ps1 = getenv("PS1");
+    if (!ps1) ps1 = DEFAULT_PS1;
     const char *user = getenv("USER");
     if (!user || !*user) user = "root";
-    if (getcwd(cwd, sizeof(cwd)) == NULL) strcpy(cwd, "?");
-    if (gethostname(hostname, sizeof(hostname)) != 0) strcpy(hostname, "solix");
-    // truncate cwd to last 2 segments
-    char truncated[MAX_PATH_LEN];
-    const char *p = cwd; const char *last = cwd; const char *second = cwd;
-    for (; *p; ++p) if (*p=='/') { second = last; last = p+1; }
-    if (second==cwd) snprintf(truncated, sizeof(truncated), "%s", cwd);
-    else snprintf(truncated, sizeof(truncated), "/%s/%s", second, last);
-    printf("%s%s@%s:%s$ %s", PROMPT_COLOR, user, hostname, truncated, RESET_COLOR);
-    fflush(stdout);
+
+    size_t len = 0;
+    prompt_append(&len, PROMPT_COLOR);
+    for (const char *p = ps1; *p; p++) {
+        if (*p != '\\' || !p[1]) { chr[0] = *p; prompt_append(&len, chr); continue; }
+        p++;
+        if ((*p=='w' || *p=='W') && !have_cwd) {
+            if (getcwd(cwd, sizeof(cwd)) == NULL) strcpy(cwd, "?");
+            have_cwd = 1;
+        }
+        if ((*p=='h' || *p=='H') && !have_host) {
+            if (gethostname(hostname, sizeof(hostname)) != 0) strcpy(hostname, "solix");
+            hostname[sizeof(hostname)-1] = '\0';
+            have_host = 1;
+        }
+        switch (*p) {
+        case 'u': prompt_append(&len, user); break;
+        case 'H': prompt_append(&len, hostname); break;
+        case 'h': {
+            char shorthost[256]; snprintf(shorthost, sizeof(shorthost), "%s", hostname);
+            char *dot = strchr(shorthost, '.'); if (dot) *dot = '\0';
+            prompt_append(&len, shorthost);
+            break;
+        }
+        case 'w': {
+            // truncate cwd to last 2 segments
+            const char *last = NULL, *second = NULL;
+            for (const char *q = cwd; *q; q++) if (*q=='/' && q[1]) { second = last; last = q; }
+            if (second && second != cwd) prompt_append(&len, second);
+            else prompt_append(&len, cwd);
+            break;
+        }
+        case 'W': {
+            const char *base = strrchr(cwd, '/');
+            prompt_append(&len, (base && base[1])? base + 1 : cwd);
+            break;
+        }
+        case '$': prompt_append(&len, geteuid()==0? "#" : "$"); break;
+        case 'n': prompt_append(&len, "\n"); break;
+        case '\\': prompt_append(&len, "\\"); break;
+        default: chr[0] = '\\'; prompt_append(&len, chr); chr[0] = *p; prompt_append(&len, chr); break;
+        }
+    }
+    prompt_append(&len, RESET_COLOR);
+    prompt_cache[len] = '\0';
+    prompt_cache_len = len;
+    prompt_dirty = 0;
+}
+
+void print_prompt(void)
+{
+    if (prompt_dirty) build_prompt();
+    out_write(prompt_cache, prompt_cache_len);
+    out_flush();
+}
+
+/**
+ * Allocate from the per-line arena
+ * Never fails: the shell cannot continue without parse memory.
+ */
+void *arena_alloc(size_t size)
+{
+    size = (size + 15) & ~(size_t)15;
+    while (arena_cur && arena_cur->used + size > arena_cur->cap) arena_cur = arena_cur->next;
+    if (!arena_cur){
+        size_t cap = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        struct arena_chunk *c = malloc(sizeof(*c) + cap);
+        if (!c) { perror("solix: arena"); exit(1); }
+        c->cap = cap; c->used = 0;
+        // append so chunks are reused in order after a reset
+        c->next = NULL;
+        if (!arena_head) arena_head = c;
+        else { struct arena_chunk *t = arena_head; while (t->next) t = t->next; t->next = c; }
+        arena_cur = c;
+    }
+    void *ptr = arena_cur->data + arena_cur->used;
+    arena_cur->used += size;
+    return ptr;
+}
+
+char *arena_strdup(const char *str)
+{
+    size_t len = strlen(str);
+    char *copy = arena_alloc(len + 1);
+    memcpy(copy, str, len + 1);
+    return copy;
+}
+
+/**
+ * Release everything allocated for the previous line
+ */
+void arena_reset(void)
+{
+    for (struct arena_chunk *c = arena_head; c; c = c->next) c->used = 0;
+    arena_cur = arena_head;
 }
 
 /**
  * Read a command from user input
+ * The line buffer grows as needed, so long lines are never truncated.
  */
 char *read_command(void)
 {
-    static char buf[MAX_CMD_LEN];
-    if (!fgets(buf, sizeof(buf), stdin)) return NULL;
-    size_t len = strlen(buf);
+    static char *buf = NULL; static size_t cap = 0;
+    ssize_t len = getline(&buf, &cap, stdin);
+    if (len < 0) return NULL;
     if (len && buf[len-1]=='\n') buf[len-1]='\0';
     return buf;
 }
 
 /**
- * Parse command into arguments
+ * Split a line into typed tokens
+ * Tokens and word text are written into the line arena; the token array
+ * is sized from the line length (each token consumes at least one input
+ * byte). Quotes and backslashes are consumed here, so only operator
+ * tokens ever act as operators.
  */
 static int is_space(char c){ return c==' '||c=='\t'; }
+static int is_op_char(char c){ return c==';'||c=='|'||c=='>'||c=='<'||c=='&'; }
 
-int tokenize_command(const char *line, char *tokens[], int max_tokens)
+int tokenize_command(const char *line, struct token **tokens_out)
 {
+    size_t len = strlen(line);
+    struct token *tokens = arena_alloc((len + 1) * sizeof(struct token));
+    char *out = arena_alloc(len + 1);
     int count = 0; const char *p = line;
     while (*p) {
         while (is_space(*p)) p++;
         if (!*p) break;
-        if (count >= max_tokens) break;
-        // two-char operators
-        if ((p[0]=='&'&&p[1]=='&') || (p[0]=='|'&&p[1]=='|') || (p[0]=='>'&&p[1]=='>')) {
-            tokens[count++] = strndup(p, 2); p+=2; continue;
-        }
-        // one-char operators ; | > <
-        if (*p==';' || *p=='|' || *p=='>' || *p=='<') { tokens[count++] = strndup(p,1); p++; continue; }
-        // word with quotes
-        char buf[MAX_CMD_LEN]; int bi=0; int in_s=0,in_d=0;
-        while (*p && (in_s||in_d || (!is_space(*p) && *p!=';' && *p!='|' && *p!='>' && *p!='<'))) {
+        if (*p=='#') break; // comment to end of line
+        struct token *t = &tokens[count++];
+        t->expand = 0; t->text = NULL;
+        // two-char operators, then one-char operators ; | > < &
+        if (p[0]=='&' && p[1]=='&') { t->type = TOK_AND; p += 2; continue; }
+        if (p[0]=='|' && p[1]=='|') { t->type = TOK_OR; p += 2; continue; }
+        if (p[0]=='>' && p[1]=='>') { t->type = TOK_REDIR_APPEND; p += 2; continue; }
+        switch (*p) {
+        case ';': t->type = TOK_SEMI; p++; continue;
+        case '|': t->type = TOK_PIPE; p++; continue;
+        case '>': t->type = TOK_REDIR_OUT; p++; continue;
+        case '<': t->type = TOK_REDIR_IN; p++; continue;
+        case '&': t->type = TOK_BG; p++; continue;
+        }
+        // word with quotes; only a leading $ outside '...' and \ expands
+        t->type = TOK_WORD; t->text = out;
+        int in_s=0,in_d=0;
+        while (*p && (in_s||in_d || (!is_space(*p) && !is_op_char(*p)))) {
             if (!in_s && *p=='"') { in_d = !in_d; p++; continue; }
             if (!in_d && *p=='\'') { in_s = !in_s; p++; continue; }
-            if (*p=='\\' && p[1]) { buf[bi++] = p[1]; p += 2; continue; }
-            buf[bi++]=*p++;
-            if (bi>=MAX_CMD_LEN-1) break;
+            if (*p=='\\' && p[1]) { *out++ = p[1]; p += 2; continue; }
+            if (out==t->text && *p=='$' && !in_s) t->expand = 1;
+            *out++ = *p++;
         }
-        buf[bi]='\0';
-        tokens[count++] = strdup(buf);
+        *out++ = '\0';
     }
+    *tokens_out = tokens;
     return count;
 }
 
-void free_tokens(char *tokens[], int count)
+/**
+ * Value of a word flagged for expansion: $?, $#, $0..$9, $! or $NAME
+ * Evaluated when the command runs, so $? and $! see the commands before
+ * it on the same line. An unset $NAME is left as written.
+ */
+static char *expand_word(char *w)
+{
+    char num[16];
+    if (w[1]=='?' && !w[2]) { snprintf(num, sizeof(num), "%d", last_status); return arena_strdup(num); }
+    // positional parameters: $0..$9 and $#
+    if (w[1]=='#' && !w[2]) { snprintf(num, sizeof(num), "%d", script_nargs>0? script_nargs-1 : 0); return arena_strdup(num); }
+    if (w[1]>='0' && w[1]<='9' && !w[2]) {
+        int n = w[1]-'0';
+        if (n==0 && script_nargs==0) return "shell";
+        return n<script_nargs? script_args[n] : "";
+    }
+    if (w[1]=='!' && !w[2]) {
+        num[0] = '\0';
+        if (last_bg_pid > 0) snprintf(num, sizeof(num), "%d", (int)last_bg_pid);
+        return arena_strdup(num);
+    }
+    // simple $VAR expansion
+    if (w[1]) {
+        const char *val = getenv(w + 1);
+        if (val) return arena_strdup(val);
+    }
+    return w;
+}
+
+/**
+ * Build the command list for tokens[0..count-1] in one malloc'd block
+ * A first pass counts commands, stages, argv slots and text bytes; the
+ * second fills the block, so the result is relocation-free and can be
+ * cached as is. Returns NULL if the line holds no command.
+ */
+static struct cmd_list *parse_tokens(const char *line, const struct token *tokens, int count)
+{
+    int ncmds = 0, nstages = 0, nslots = 0; size_t text = strlen(line) + 1;
+    int words = 0;
+    for (int i=0; i<=count; i++){
+        enum tok_type ty = i<count? tokens[i].type : TOK_SEMI;
+        if (ty==TOK_WORD) { words++; text += strlen(tokens[i].text) + 1; continue; }
+        if (ty==TOK_REDIR_IN || ty==TOK_REDIR_OUT || ty==TOK_REDIR_APPEND) continue;
+        // a stage ends here: its words plus the NULL
+        nstages++; nslots += words + 1; words = 0;
+        if (ty!=TOK_PIPE) ncmds++;
+    }
+    // a trailing ; or & ends the line rather than starting an empty command
+    if (count>0 && (tokens[count-1].type==TOK_SEMI || tokens[count-1].type==TOK_BG)) { ncmds--; nstages--; nslots--; }
+    if (ncmds<=0) return NULL;
+
+    size_t size = sizeof(struct cmd_list) + ncmds * sizeof(struct command)
+                + nstages * sizeof(struct stage) + nslots * sizeof(char *) + nslots + text;
+    struct cmd_list *list = malloc(size);
+    if (!list) { perror("solix: parse"); return NULL; }
+    struct stage *st = (struct stage *)(list->cmds + ncmds);
+    char **slot = (char **)(st + nstages);
+    unsigned char *flag = (unsigned char *)(slot + nslots);
+    char *tp = (char *)(flag + nslots);
+    list->ncmds = ncmds;
+
+    int ci = 0, i = 0;
+    while (ci < ncmds) {
+        struct command *cmd = &list->cmds[ci++];
+        cmd->stages = st; cmd->nstages = 0; cmd->timed = 0; cmd->empty = 0; cmd->expand = 0;
+        cmd->connector = TOK_SEMI;
+        for (;;) {
+            struct stage *s = &st[cmd->nstages++];
+            s->argv = slot; s->in_file = NULL; s->out_file = NULL; s->append = 0;
+            s->expand = NULL; s->redir_expand = 0;
+            int argc = 0;
+            for (; i<count && (tokens[i].type==TOK_WORD || tokens[i].type>=TOK_REDIR_IN); i++){
+                const struct token *t = &tokens[i];
+                size_t l;
+                if (t->type==TOK_WORD) {
+                    l = strlen(t->text) + 1;
+                    slot[argc] = memcpy(tp, t->text, l); tp += l;
+                    flag[argc] = (unsigned char)t->expand;
+                    if (t->expand) s->expand = flag;
+                    argc++;
+                    continue;
+                }
+                // redirection: the next word is its target (syntax_check saw to it)
+                l = strlen(tokens[i+1].text) + 1;
+                char *target = memcpy(tp, tokens[i+1].text, l); tp += l;
+                if (t->type==TOK_REDIR_IN) {
+                    s->in_file = target;
+                    if (tokens[i+1].expand) s->redir_expand |= EXPAND_IN;
+                } else {
+                    s->out_file = target; s->append = (t->type==TOK_REDIR_APPEND);
+                    if (tokens[i+1].expand) s->redir_expand |= EXPAND_OUT;
+                }
+                i++;
+            }
+            slot[argc] = NULL;
+            if (s->expand || s->redir_expand) cmd->expand = 1;
+            if (argc==0) cmd->empty = 1;
+            slot += argc + 1; flag += argc + 1;
+            if (i<count && tokens[i].type==TOK_PIPE) { i++; continue; }
+            break;
+        }
+        if (i<count) cmd->connector = tokens[i++].type;
+        st += cmd->nstages;
+        // time prefix: applies to the whole pipeline
+        struct stage *first = &cmd->stages[0];
+        if (first->argv[0] && strcmp(first->argv[0], "time")==0) {
+            first->argv++;
+            if (first->expand) first->expand++;
+            cmd->timed = (cmd->connector != TOK_BG);
+            if (!first->argv[0] && cmd->nstages==1) cmd->empty = 1;
+        }
+    }
+    list->line = strcpy(tp, line);
+    return list;
+}
+
+/**
+ * Index of the first token the grammar does not allow, count for an
+ * unexpected end of line, or -1 if tokens[0..count-1] are well formed:
+ * every | && || ; & follows a non-empty stage, | && || are followed by
+ * one, and every redirection by its target word.
+ */
+static int syntax_check(const struct token *tokens, int count)
+{
+    int have = 0; // the current stage has a word or a redirection
+    for (int i=0; i<count; i++){
+        enum tok_type ty = tokens[i].type;
+        if (ty==TOK_WORD) { have = 1; continue; }
+        if (ty>=TOK_REDIR_IN) {
+            if (i+1>=count || tokens[i+1].type!=TOK_WORD) return i+1;
+            have = 1; i++;
+            continue;
+        }
+        if (!have) return i;
+        have = 0;
+    }
+    if (count>0 && !have && tokens[count-1].type!=TOK_SEMI && tokens[count-1].type!=TOK_BG) return count;
+    return -1;
+}
+
+static const char *tok_name(enum tok_type ty)
+{
+    static const char *const names[] = { "word", "|", "&&", "||", ";", "&", "<", ">", ">>" };
+    return names[ty];
+}
+
+static unsigned fnv1a(const char *s)
+{
+    unsigned h = 2166136261u;
+    for (; *s; s++) { h ^= (unsigned char)*s; h *= 16777619u; }
+    return h;
+}
+
+/**
+ * Parsed form of line, from the parse cache or freshly built into it
+ * The cache is direct-mapped on the line's hash; a colliding line evicts
+ * the older entry. Lists hold no expanded values, so they stay valid
+ * whatever the environment does. The result lives until the next
+ * parse_line call, which may evict it; NULL if the line has no command.
+ * A syntax error is reported, sets last_status to 2 and is never cached.
+ */
+struct cmd_list *parse_line(const char *line)
+{
+    struct cmd_list **slot = &parse_cache[fnv1a(line) % PARSE_CACHE_SIZE];
+    if (*slot && strcmp((*slot)->line, line)==0) return *slot;
+    struct token *tokens;
+    int ntok = tokenize_command(line, &tokens);
+    int bad = syntax_check(tokens, ntok);
+    if (bad >= 0) {
+        fprintf(stderr, "%ssolix: syntax error near `%s'%s\n", ERROR_COLOR,
+                bad<ntok? tok_name(tokens[bad].type) : "newline", RESET_COLOR);
+        last_status = 2;
+        return NULL;
+    }
+    struct cmd_list *list = ntok>0? parse_tokens(line, tokens, ntok) : NULL;
+    if (!list) return NULL;
+    free(*slot);
+    *slot = list;
+    return list;
+}
+
+/**
+ * Builtin lookup
+ * FNV-1a with a seed, folded to BUILTIN_SLOTS. builtin_hash_init picks,
+ * once at startup, the first seed under which every builtin name gets a
+ * slot of its own, so a lookup is one hash, one load and one strcmp
+ * however long the table grows, and no generator has to be re-run when
+ * a builtin is added.
+ */
+static unsigned builtin_slot(const char *name, unsigned seed)
+{
+    unsigned h = 2166136261u ^ seed;
+    for (; *name; name++) { h ^= (unsigned char)*name; h *= 16777619u; }
+    return (h ^ (h >> 16)) % BUILTIN_SLOTS;
+}
+
+static void builtin_hash_init(void)
+{
+    for (unsigned seed = 0; seed < 65536; seed++){
+        memset(builtin_slots, 0, sizeof(builtin_slots));
+        int i = 0;
+        for (; builtin_commands[i].name; i++){
+            unsigned h = builtin_slot(builtin_commands[i].name, seed);
+            if (builtin_slots[h]) break;
+            builtin_slots[h] = (unsigned char)(i + 1);
+        }
+        if (!builtin_commands[i].name) { builtin_seed = seed; return; }
+    }
+    fprintf(stderr, "solix: no perfect hash for %d builtins; raise BUILTIN_SLOTS\n", (int)(sizeof(builtin_commands) / sizeof(builtin_commands[0])) - 1);
+    exit(2);
+}
+
+/**
+ * Handler for a builtin name, or NULL; callers dispatch through it directly
+ */
+builtin_fn find_builtin(const char *name)
+{
+    if (!name) return NULL;
+    unsigned i = builtin_slots[builtin_slot(name, builtin_seed)];
+    if (!i || strcmp(builtin_commands[i - 1].name, name) != 0) return NULL;
+    return builtin_commands[i - 1].function;
+}
+
+static int status_from_wait(int status)
+{
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+static int open_redirs(const char *in_file, const char *out_file, int append, int *in_fd, int *out_fd)
+{
+    *in_fd = -1; *out_fd = -1;
+    if (in_file){ *in_fd = open(in_file, O_RDONLY|O_CLOEXEC); if (*in_fd<0){ perror("open in"); return -1; } }
+    if (out_file){
+        int flags = O_WRONLY|O_CREAT|O_CLOEXEC|(append?O_APPEND:O_TRUNC);
+        *out_fd = open(out_file, flags, 0644);
+        if (*out_fd<0){ perror("open out"); if (*in_fd!=-1) close(*in_fd); *in_fd=-1; return -1; }
+    }
+    return 0;
+}
+
+/**
+ * Command hash: name -> absolute path, resolved once per PATH
+ * Cleared when PATH changes; a stale entry is dropped when exec reports ENOENT.
+ */
+static unsigned hash_name(const char *name)
+{
+    return fnv1a(name) % CMD_HASH_BUCKETS;
+}
+
+static int path_search(const char *name, char *buf, size_t len)
+{
+    const char *path = getenv("PATH"); if (!path) path = "/bin:/sbin:/usr/bin:/usr/sbin";
+    const char *p = path; struct stat st;
+    while (*p){
+        const char *q = strchr(p, ':'); size_t dlen = q? (size_t)(q-p) : strlen(p);
+        snprintf(buf, len, "%.*s/%s", (int)dlen, dlen? p : ".", name);
+        if (stat(buf, &st)==0 && S_ISREG(st.st_mode) && access(buf, X_OK)==0) return 0;
+        if (!q) break;
+        p = q+1;
+    }
+    return -1;
+}
+
+static struct cmd_hash_entry *hash_find(const char *name)
+{
+    for (struct cmd_hash_entry *e = cmd_hash[hash_name(name)]; e; e = e->next)
+        if (strcmp(e->name, name)==0) return e;
+    return NULL;
+}
+
+/**
+ * Look name up in the hash, searching PATH and caching the result on a miss
+ */
+static const char *hash_lookup(const char *name, int count_hit)
+{
+    struct cmd_hash_entry *e = hash_find(name);
+    if (!e){
+        char buf[MAX_PATH_LEN];
+        if (path_search(name, buf, sizeof(buf)) < 0) return NULL;
+        e = malloc(sizeof(*e));
+        if (!e) return NULL;
+        e->name = strdup(name); e->path = strdup(buf); e->hits = 0;
+        if (!e->name || !e->path) { free(e->name); free(e->path); free(e); return NULL; }
+        unsigned b = hash_name(name);
+        e->next = cmd_hash[b]; cmd_hash[b] = e;
+    }
+    if (count_hit) e->hits++;
+    return e->path;
+}
+
+static void hash_forget(const char *name)
+{
+    struct cmd_hash_entry **pp = &cmd_hash[hash_name(name)];
+    for (; *pp; pp = &(*pp)->next){
+        if (strcmp((*pp)->name, name)==0){
+            struct cmd_hash_entry *e = *pp; *pp = e->next;
+            free(e->name); free(e->path); free(e);
+            return;
+        }
+    }
+}
+
+static void hash_clear(void)
+{
+    for (int b=0; b<CMD_HASH_BUCKETS; b++){
+        while (cmd_hash[b]){
+            struct cmd_hash_entry *e = cmd_hash[b]; cmd_hash[b] = e->next;
+            free(e->name); free(e->path); free(e);
+        }
+    }
+}
+
+// Path to exec for argv[0]: taken literally if it contains '/', else from the hash
+static const char *command_path(const char *name)
+{
+    if (strchr(name, '/')) return name;
+    return hash_lookup(name, 1);
+}
+
+/**
+ * Job table
+ * Every launched command or pipeline is a job with its own process group
+ * (when job control is on). Foreground jobs are dropped once they finish;
+ * background and stopped jobs stay until reported or waited for.
+ */
+static const int job_signals[] = {SIGINT, SIGQUIT, SIGTSTP, SIGTTIN, SIGTTOU, SIGCHLD};
+
+static void block_sigchld(sigset_t *old)
+{
+    sigset_t set; sigemptyset(&set); sigaddset(&set, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &set, old);
+}
+
+/**
+ * Collect every pending child status change without blocking
+ * Runs from the SIGCHLD handler, and from the main code with SIGCHLD
+ * blocked to pick up anything left behind while the queue was full.
+ */
+static void reap_children(void)
+{
+    while (chld_queue_len < CHLD_QUEUE_SIZE) {
+        int st;
+        pid_t pid = wait4(-1, &st, WNOHANG|WUNTRACED|WCONTINUED, &chld_queue[chld_queue_len].ru);
+        if (pid <= 0) break;
+        chld_queue[chld_queue_len].pid = pid;
+        chld_queue[chld_queue_len].status = st;
+        chld_queue_len++;
+    }
+}
+
+static void sigchld_handler(int sig)
+{
+    (void)sig;
+    int saved = errno;
+    reap_children();
+    errno = saved;
+}
+
+/**
+ * Apply queued status changes to the job table (SIGCHLD must be blocked)
+ * Children that belong to no job, e.g. orphans reparented to the shell
+ * running as PID 1, are simply discarded.
+ */
+static void update_jobs(void)
+{
+    for (;;) {
+        reap_children();
+        if (!chld_queue_len) break;
+        for (int i=0; i<chld_queue_len; i++){
+            pid_t pid = chld_queue[i].pid; int st = chld_queue[i].status;
+            for (struct job *j = job_list; j; j = j->next){
+                struct job_proc *p = NULL;
+                for (int k=0; k<j->nprocs; k++) if (j->procs[k].pid == pid) { p = &j->procs[k]; break; }
+                if (!p) continue;
+                if (WIFCONTINUED(st)) { p->state = PROC_RUNNING; break; }
+                if (WIFSTOPPED(st)) { p->state = PROC_STOPPED; p->status = 128 + WSTOPSIG(st); }
+                else { p->state = PROC_DONE; p->status = status_from_wait(st); p->ru = chld_queue[i].ru; }
+                j->notify = 1;
+                break;
+            }
+        }
+        chld_queue_len = 0;
+    }
+}
+
+static int job_is_done(const struct job *j)
+{
+    for (int k=0; k<j->nprocs; k++) if (j->procs[k].state != PROC_DONE) return 0;
+    return 1;
+}
+
+static int job_is_stopped(const struct job *j)
+{
+    int stopped = 0;
+    for (int k=0; k<j->nprocs; k++){
+        if (j->procs[k].state == PROC_RUNNING) return 0;
+        if (j->procs[k].state == PROC_STOPPED) stopped = 1;
+    }
+    return stopped;
+}
+
+// Last stage's status, or the rightmost failure with pipefail; 128+sig if stopped
+static int job_status(const struct job *j)
+{
+    int failed = 0;
+    for (int k=0; k<j->nprocs; k++){
+        if (j->procs[k].state == PROC_STOPPED) return j->procs[k].status;
+        if (j->procs[k].status != 0) failed = j->procs[k].status;
+    }
+    if (opt_pipefail && failed) return failed;
+    return j->nprocs? j->procs[j->nprocs-1].status : 0;
+}
+
+/**
+ * Render stages as "argv... | argv..." into buf (NULL: only measure)
+ * Returns the length, not counting the NUL written at the end.
+ */
+static size_t stages_text(const struct stage *stages, int n, char *buf)
+{
+    size_t len = 0;
+    for (int i=0; i<n; i++){
+        if (i) { if (buf) memcpy(buf + len, " | ", 3); len += 3; }
+        for (int a=0; stages[i].argv[a]; a++){
+            size_t l = strlen(stages[i].argv[a]);
+            if (a) { if (buf) buf[len] = ' '; len++; }
+            if (buf) memcpy(buf + len, stages[i].argv[a], l);
+            len += l;
+        }
+    }
+    if (buf) buf[len] = '\0';
+    return len;
+}
+
+/**
+ * Create a job for stages[0..n-1]; the command text is kept for jobs/fg
+ */
+static struct job *job_new(const struct stage *stages, int n, int foreground)
+{
+    size_t clen = stages_text(stages, n, NULL);
+    struct job *j = malloc(sizeof(*j) + n * sizeof(struct job_proc) + clen + 1);
+    if (!j) { perror("solix: job"); return NULL; }
+    j->cmd = (char *)(j->procs + n);
+    stages_text(stages, n, j->cmd);
+    int id = 0;
+    for (struct job *o = job_list; o; o = o->next) if (o->id > id) id = o->id;
+    j->id = id + 1; j->pgid = 0; j->foreground = foreground; j->worker = 0; j->notify = 0; j->nprocs = 0;
+    // appended so the list stays in start order; the last job is the current one
+    j->next = NULL;
+    struct job **pp = &job_list; while (*pp) pp = &(*pp)->next;
+    *pp = j;
+    return j;
+}
+
+/**
+ * Record a launched child (pid < 0: launch failed, counts as status 1)
+ * The first child becomes the process group leader; a foreground job is
+ * handed the terminal right away. setpgid is repeated here to close the
+ * race with the child doing it itself.
+ */
+static void job_add_proc(struct job *j, pid_t pid)
+{
+    struct job_proc *p = &j->procs[j->nprocs++];
+    p->pid = pid > 0? pid : 0;
+    p->state = pid > 0? PROC_RUNNING : PROC_DONE;
+    p->status = pid > 0? 0 : 1;
+    if (pid <= 0 || !job_control) return;
+    if (!j->pgid) {
+        j->pgid = pid;
+        setpgid(pid, pid);
+        if (j->foreground && !j->worker) tcsetpgrp(STDIN_FILENO, pid);
+    } else setpgid(pid, j->pgid);
+}
+
+// Fold a finished job's rusage into child_ru for time and profiling
+static void job_account(const struct job *j)
+{
+    for (int k=0; k<j->nprocs; k++){
+        const struct rusage *ru = &j->procs[k].ru;
+        timeradd(&child_ru.ru_utime, &ru->ru_utime, &child_ru.ru_utime);
+        timeradd(&child_ru.ru_stime, &ru->ru_stime, &child_ru.ru_stime);
+        child_ru.ru_minflt += ru->ru_minflt;
+        child_ru.ru_majflt += ru->ru_majflt;
+        if (ru->ru_maxrss > child_ru.ru_maxrss) child_ru.ru_maxrss = ru->ru_maxrss;
+    }
+}
+
+static void job_remove(struct job *j)
+{
+    for (struct job **pp = &job_list; *pp; pp = &(*pp)->next)
+        if (*pp == j) { *pp = j->next; free(j); return; }
+}
+
+// '+' for the current (most recent) job, '-' for the one before it
+static char job_mark(const struct job *j)
+{
+    if (!j->next) return '+';
+    if (!j->next->next) return '-';
+    return ' ';
+}
+
+static void print_job(const struct job *j)
+{
+    char state[24];
+    if (job_is_done(j)) {
+        int rc = job_status(j);
+        if (rc) snprintf(state, sizeof(state), "Exit %d", rc); else strcpy(state, "Done");
+    } else strcpy(state, job_is_stopped(j)? "Stopped" : "Running");
+    out_printf("[%d]%c  %-22s%s%s\n", j->id, job_mark(j), state, j->cmd, (!job_is_done(j) && !job_is_stopped(j))? " &" : "");
+}
+
+/**
+ * Wait until job j finishes or stops, then take the terminal back
+ * A finished job is removed; a stopped one stays in the table as a
+ * background job. Returns the job's status (128+signal when stopped).
+ */
+static int wait_for_job(struct job *j)
+{
+    out_flush(); // blocking: nothing buffered may wait behind the job
+    sigset_t old; block_sigchld(&old);
+    int resumed = 0;
+    for (;;) {
+        update_jobs();
+        // a stage that touched the tty before tcsetpgrp stopped on SIGTTIN/SIGTTOU: continue it once
+        int tty_stop = 0;
+        for (int k=0; k<j->nprocs; k++)
+            if (j->procs[k].state == PROC_STOPPED && (j->procs[k].status == 128 + SIGTTIN || j->procs[k].status == 128 + SIGTTOU)) tty_stop = 1;
+        if (tty_stop && !resumed && job_control) {
+            resumed = 1;
+            for (int k=0; k<j->nprocs; k++) if (j->procs[k].state == PROC_STOPPED) j->procs[k].state = PROC_RUNNING;
+            kill(-j->pgid, SIGCONT);
+            continue;
+        }
+        if (job_is_done(j) || job_is_stopped(j)) break;
+        sigsuspend(&old);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+
+    if (job_control) {
+        tcsetpgrp(STDIN_FILENO, shell_pgid);
+        tcsetattr(STDIN_FILENO, TCSADRAIN, &shell_tmodes);
+    }
+    int status = job_status(j);
+    if (!job_is_done(j)) {
+        j->foreground = 0; j->notify = 0;
+        out_puts("\n"); print_job(j);
+        return status;
+    }
+    // the terminal's ^C went to the job, not to us: finish the line ourselves
+    if (job_control) for (int k=0; k<j->nprocs; k++) if (j->procs[k].status == 128 + SIGINT) { out_puts("\n"); break; }
+    job_account(j);
+    job_remove(j);
+    return status;
+}
+
+/**
+ * Continue a stopped job (SIGCONT to its process group)
+ */
+static void job_continue(struct job *j, int foreground)
+{
+    sigset_t old; block_sigchld(&old);
+    update_jobs(); // drop stale stop events before marking it running
+    for (int k=0; k<j->nprocs; k++) if (j->procs[k].state == PROC_STOPPED) j->procs[k].state = PROC_RUNNING;
+    j->foreground = foreground; j->notify = 0;
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    if (foreground) tcsetpgrp(STDIN_FILENO, j->pgid);
+    kill(-j->pgid, SIGCONT);
+}
+
+/**
+ * Report background jobs that finished or stopped since the last prompt
+ * Finished jobs are dropped; in scripts this happens silently and the job
+ * behind $! is kept so `wait $!` can still collect its status.
+ */
+static void job_notify(void)
+{
+    if (!job_list && !chld_queue_len) return;
+    sigset_t old; block_sigchld(&old);
+    update_jobs();
+    struct job **pp = &job_list;
+    while (*pp) {
+        struct job *j = *pp;
+        int done = job_is_done(j);
+        if (interactive && j->notify && !j->foreground) { print_job(j); j->notify = 0; }
+        if (done && !j->foreground && (interactive || j->procs[j->nprocs-1].pid != last_bg_pid)) { *pp = j->next; free(j); continue; }
+        pp = &j->next;
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+}
+
+/**
+ * Look up a job by spec: %N, %%, %+, %- or a pid (NULL: current job)
+ */
+static struct job *job_find(const char *spec, const char *who)
+{
+    struct job *cur = NULL, *prev = NULL;
+    for (struct job *j = job_list; j; j = j->next) { prev = cur; cur = j; }
+    struct job *found = NULL;
+    if (!spec || strcmp(spec, "%%")==0 || strcmp(spec, "%+")==0 || strcmp(spec, "%")==0) found = cur;
+    else if (strcmp(spec, "%-")==0) found = prev;
+    else if (spec[0]=='%') { int id = atoi(spec + 1); for (struct job *j = job_list; j; j = j->next) if (j->id == id) found = j; }
+    else {
+        pid_t pid = (pid_t)atoi(spec);
+        for (struct job *j = job_list; j && !found; j = j->next)
+            for (int k=0; k<j->nprocs; k++) if (pid > 0 && j->procs[k].pid == pid) found = j;
+    }
+    if (!found) { out_flush(); fprintf(stderr, "%s: %s: no such job\n", who, spec? spec : "current"); }
+    return found;
+}
+
+/**
+ * Wait for target (NULL: every job) to finish or stop; ^C interrupts
+ */
+static int wait_background(struct job *target)
+{
+    out_flush(); // blocking: earlier output must not wait for the jobs
+    sigset_t set, old;
+    sigemptyset(&set); sigaddset(&set, SIGCHLD); sigaddset(&set, SIGINT);
+    sigprocmask(SIG_BLOCK, &set, &old);
+    got_sigint = 0;
+    int rc = 0;
+    for (;;) {
+        update_jobs();
+        if (got_sigint) { rc = 130; break; }
+        int pending = 0;
+        for (struct job *j = job_list; j; j = j->next)
+            if ((!target || j == target) && !job_is_done(j) && !job_is_stopped(j)) pending = 1;
+        if (!pending) break;
+        sigsuspend(&old);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return rc;
+}
+
+/**
+ * Reset signal state in a new child; background jobs without job
+ * control ignore SIGINT/SIGQUIT so the terminal's ^C only hits the
+ * foreground command.
+ */
+static void child_signals(int ignore_int)
 {
-    for (int i=0;i<count;i++) free(tokens[i]);
+    for (size_t i=0; i<sizeof(job_signals)/sizeof(job_signals[0]); i++) signal(job_signals[i], SIG_DFL);
+    if (ignore_int) { signal(SIGINT, SIG_IGN); signal(SIGQUIT, SIG_IGN); }
+    sigset_t none; sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
 }
 
-void expand_vars(char *tokens[], int count)
+/**
+ * Fork a child wired to in_fd/out_fd that runs argv as part of job j
+ * With builtin set the child runs that handler; otherwise path is the
+ * resolved command (may be NULL) and execvp is the fallback either way.
+ */
+static pid_t fork_command(const char *path, char *const argv[], int in_fd, int out_fd, builtin_fn builtin, struct job *j)
 {
-    char numbuf[16];
-    snprintf(numbuf, sizeof(numbuf), "%d", last_status);
-    for (int i=0;i<count;i++) {
-        if (strcmp(tokens[i],"$?")==0) { free(tokens[i]); tokens[i]=strdup(numbuf); continue; }
-        // simple $VAR expansion
-        if (tokens[i][0]=='$' && tokens[i][1] && tokens[i][1] != '?') {
-            const char *val = getenv(tokens[i]+1);
-            if (val) { free(tokens[i]); tokens[i]=strdup(val); }
+    pid_t pid = fork();
+    if (pid==0){
+        if (job_control) {
+            pid_t pg = j->pgid? j->pgid : getpid();
+            setpgid(0, pg);
+            if (j->foreground && !j->worker) tcsetpgrp(STDIN_FILENO, pg);
         }
+        child_signals(!j->foreground && !job_control);
+        if (in_fd != -1) { dup2(in_fd, STDIN_FILENO); }
+        if (out_fd != -1) { dup2(out_fd, STDOUT_FILENO); }
+        if (builtin){ int rc = builtin((char **)argv); out_flush(); _exit(rc); }
+        if (path) execv(path, (char* const*)argv);
+        execvp(argv[0], (char* const*)argv);
+        fprintf(stderr, "%ssolix: %s: command not found%s\n", ERROR_COLOR, argv[0], RESET_COLOR);
+        _exit(127);
     }
+    if (pid<0) perror("fork");
+    return pid;
 }
 
 /**
- * Execute a command (built-in or external)
+ * Launch path with posix_spawn; in_fd/out_fd are moved onto stdin/stdout
+ * by spawn file actions, and spawn attributes put the child in j's process
+ * group with default signal dispositions and an empty mask.
+ * Returns -1 with errno set if the spawn failed.
  */
-int is_builtin(const char *cmd){
-    if (!cmd) return 0;
-    for (int i=0; builtin_commands[i].name; i++) if (strcmp(cmd,builtin_commands[i].name)==0) return 1;
+static pid_t spawn_external(const char *path, char *const argv[], int in_fd, int out_fd, struct job *j)
+{
+    posix_spawn_file_actions_t fa; posix_spawnattr_t attr; pid_t pid; int rc;
+    sigset_t none, dfl;
+    if ((rc = posix_spawn_file_actions_init(&fa)) != 0) { errno = rc; return -1; }
+    if ((rc = posix_spawnattr_init(&attr)) != 0) { posix_spawn_file_actions_destroy(&fa); errno = rc; return -1; }
+    if (in_fd != -1) posix_spawn_file_actions_adddup2(&fa, in_fd, STDIN_FILENO);
+    if (out_fd != -1) posix_spawn_file_actions_adddup2(&fa, out_fd, STDOUT_FILENO);
+    sigemptyset(&none); sigemptyset(&dfl);
+    for (size_t i=0; i<sizeof(job_signals)/sizeof(job_signals[0]); i++) sigaddset(&dfl, job_signals[i]);
+    posix_spawnattr_setsigmask(&attr, &none);
+    posix_spawnattr_setsigdefault(&attr, &dfl);
+    short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    if (job_control) { flags |= POSIX_SPAWN_SETPGROUP; posix_spawnattr_setpgroup(&attr, j->pgid); }
+    posix_spawnattr_setflags(&attr, flags);
+    rc = posix_spawn(&pid, path, &fa, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) { errno = rc; return -1; }
+    return pid;
+}
+
+/**
+ * Start an external command in job j without waiting for it
+ * Uses the spawn path and only forks when it cannot be used (spawn disabled,
+ * command missing or not directly executable) so execvp can report the error
+ * or fall back to /bin/sh for scripts without a #! line. Background jobs
+ * without job control also fork, since spawn cannot set SIG_IGN.
+ */
+static pid_t launch_external(char *const argv[], int in_fd, int out_fd, struct job *j)
+{
+    out_flush();
+    const char *base = strrchr(argv[0], '/');
+    if (strcmp(base? base + 1 : argv[0], "hostname")==0) prompt_dirty = 1;
+    const char *path = command_path(argv[0]);
+    if (opt_spawn && path && (j->foreground || job_control)) {
+        pid_t pid = spawn_external(path, argv, in_fd, out_fd, j);
+        if (pid < 0 && errno == ENOENT && path != argv[0]) {
+            // cached location vanished: rehash and retry once
+            hash_forget(argv[0]);
+            path = command_path(argv[0]);
+            if (path) pid = spawn_external(path, argv, in_fd, out_fd, j);
+        }
+        if (pid > 0) return pid;
+    }
+    return fork_command(path, argv, in_fd, out_fd, NULL, j);
+}
+
+int exec_external(char *const argv[], int in_fd, int out_fd)
+{
+    struct stage st = { .argv = (char **)argv };
+    sigset_t old; block_sigchld(&old);
+    struct job *j = job_new(&st, 1, 1);
+    if (!j) { sigprocmask(SIG_SETMASK, &old, NULL); return 1; }
+    job_add_proc(j, launch_external(argv, in_fd, out_fd, j));
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return wait_for_job(j);
+}
+
+int exec_simple(char *const argv[], const char *in_file, const char *out_file, int append)
+{
+    int in_fd, out_fd; int rc;
+    if (open_redirs(in_file, out_file, append, &in_fd, &out_fd) < 0) return 1;
+    builtin_fn builtin = find_builtin(argv[0]);
+    if (builtin && in_fd==-1 && out_fd==-1){
+        rc = builtin((char **)argv);
+    } else if ((rc = exec_applet_redir(argv, in_fd, out_fd)) >= 0) {
+        // applet ran in-process with its fds swapped in
+    } else {
+        rc = exec_external(argv, in_fd, out_fd);
+    }
+    if (in_fd!=-1) close(in_fd);
+    if (out_fd!=-1) close(out_fd);
+    return rc;
+}
+
+/**
+ * Run stages[0] | stages[1] | ... | stages[n-1] as one job
+ * One pipe per link and one child per stage, all in the job's process
+ * group. SIGCHLD stays blocked until every child is registered so the
+ * reaper cannot see a pid the job table does not know yet.
+ * In the foreground, returns the job's status; in the background, sets $!
+ * and returns 0 immediately.
+ */
+int exec_pipeline(struct stage *stages, int n, int background)
+{
+    sigset_t old; block_sigchld(&old);
+    struct job *j = job_new(stages, n, !background);
+    if (!j) { sigprocmask(SIG_SETMASK, &old, NULL); return 1; }
+    int prev_rd = -1;
+    out_flush();
+    for (int i=0; i<n; i++){
+        // CLOEXEC so spawned stages only keep the ends dup'd onto 0/1
+        int pfd[2] = {-1, -1};
+        if (i<n-1 && pipe2(pfd, O_CLOEXEC)<0){ perror("pipe"); break; }
+        int in_fd, out_fd; pid_t pid = -1;
+        if (open_redirs(stages[i].in_file, stages[i].out_file, stages[i].append, &in_fd, &out_fd) == 0){
+            int use_in = (in_fd!=-1)? in_fd : prev_rd;
+            int use_out = (out_fd!=-1)? out_fd : pfd[1];
+            builtin_fn builtin = find_builtin(stages[i].argv[0]);
+            if (builtin) pid = fork_command(NULL, stages[i].argv, use_in, use_out, builtin, j);
+            else pid = launch_external(stages[i].argv, use_in, use_out, j);
+            if (in_fd!=-1) close(in_fd);
+            if (out_fd!=-1) close(out_fd);
+        }
+        if (prev_rd!=-1) close(prev_rd);
+        if (pfd[1]!=-1) close(pfd[1]);
+        prev_rd = pfd[0];
+        job_add_proc(j, pid);
+    }
+    if (prev_rd!=-1) close(prev_rd);
+    while (j->nprocs < n) job_add_proc(j, -1);
+    sigprocmask(SIG_SETMASK, &old, NULL);
+
+    if (!background) return wait_for_job(j);
+    last_bg_pid = j->procs[n-1].pid;
+    if (interactive) { out_printf("[%d] %d\n", j->id, (int)last_bg_pid); out_flush(); }
     return 0;
 }
 
-int exec_builtin(char *const argv[]){
-    for (int i=0; builtin_commands[i].name; i++) if (strcmp(argv[0], builtin_commands[i].name)==0) return builtin_commands[i].function((char**)argv);
-    return 127;
+/**
+ * Command timing: wall clock plus rusage of the shell itself (builtins)
+ * and of the jobs it waited for in between, collected by wait4.
+ */
+static void timer_start(struct cmd_timer *t)
+{
+    clock_gettime(CLOCK_MONOTONIC, &t->wall);
+    getrusage(RUSAGE_SELF, &t->self);
+    t->child = child_ru;
+    // peak RSS of this command only; the outer peak is restored on stop
+    t->saved_maxrss = child_ru.ru_maxrss;
+    child_ru.ru_maxrss = 0;
+}
+
+static double tv_diff(struct timeval a, struct timeval b)
+{
+    return (double)(a.tv_sec - b.tv_sec) + (double)(a.tv_usec - b.tv_usec) / 1e6;
+}
+
+static void timer_stop(struct cmd_timer *t, struct cmd_times *out)
+{
+    struct timespec now; struct rusage self;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    getrusage(RUSAGE_SELF, &self);
+    out->real = (double)(now.tv_sec - t->wall.tv_sec) + (double)(now.tv_nsec - t->wall.tv_nsec) / 1e9;
+    out->user = tv_diff(self.ru_utime, t->self.ru_utime) + tv_diff(child_ru.ru_utime, t->child.ru_utime);
+    out->sys = tv_diff(self.ru_stime, t->self.ru_stime) + tv_diff(child_ru.ru_stime, t->child.ru_stime);
+    out->majflt = (self.ru_majflt - t->self.ru_majflt) + (child_ru.ru_majflt - t->child.ru_majflt);
+    out->minflt = (self.ru_minflt - t->self.ru_minflt) + (child_ru.ru_minflt - t->child.ru_minflt);
+    // no child ran: the command was a builtin, report the shell's own peak
+    out->maxrss = child_ru.ru_maxrss? child_ru.ru_maxrss : self.ru_maxrss;
+    if (t->saved_maxrss > child_ru.ru_maxrss) child_ru.ru_maxrss = t->saved_maxrss;
+}
+
+static void print_times(const struct cmd_times *tm)
+{
+    out_flush();
+    fprintf(stderr, "\nreal\t%dm%.3fs\nuser\t%dm%.3fs\nsys\t%dm%.3fs\nmaxrss\t%ld KB\nfaults\t%ld major, %ld minor\n",
+            (int)(tm->real / 60), tm->real - 60 * (int)(tm->real / 60),
+            (int)(tm->user / 60), tm->user - 60 * (int)(tm->user / 60),
+            (int)(tm->sys / 60), tm->sys - 60 * (int)(tm->sys / 60),
+            tm->maxrss, tm->majflt, tm->minflt);
+}
+
+/**
+ * Open or close the profile log after SOLIX_PROFILE or SOLIX_PROFILE_FILE change
+ */
+static void profile_update(void)
+{
+    if (profile_fd >= 0) { close(profile_fd); profile_fd = -1; }
+    const char *on = getenv("SOLIX_PROFILE");
+    if (!on || strcmp(on, "1")!=0) return;
+    const char *file = getenv("SOLIX_PROFILE_FILE");
+    if (!file || !*file) file = DEFAULT_PROFILE_FILE;
+    profile_fd = open(file, O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+    if (profile_fd < 0) fprintf(stderr, "solix: profile: %s: %s\n", file, strerror(errno));
+}
+
+/**
+ * Append one record: real/user/sys ms, maxrss KB, major/minor faults, status, command
+ */
+static void profile_log(const struct stage *stages, int n, const struct cmd_times *tm, int status)
+{
+    size_t clen = stages_text(stages, n, NULL);
+    size_t cap = clen + 128;
+    char *rec = arena_alloc(cap);
+    int len = snprintf(rec, cap, "%.3f\t%.3f\t%.3f\t%ld\t%ld\t%ld\t%d\t",
+                       tm->real * 1e3, tm->user * 1e3, tm->sys * 1e3, tm->maxrss, tm->majflt, tm->minflt, status);
+    if (len < 0 || (size_t)len + clen + 2 > cap) return;
+    stages_text(stages, n, rec + len);
+    rec[len + clen] = '\n';
+    write_all(profile_fd, rec, (size_t)len + clen + 1);
 }
 
-int exec_external(char *const argv[], int in_fd, int out_fd)
+/**
+ * Copy stages[0..n-1] of a parsed command into the arena with their
+ * flagged words expanded; unflagged words are shared, not copied
+ */
+static struct stage *expand_stages(const struct stage *src, int n)
 {
-    pid_t pid = fork();
-    if (pid==0){
-        signal(SIGINT, SIG_DFL);
-        if (in_fd != -1) { dup2(in_fd, STDIN_FILENO); }
-        if (out_fd != -1) { dup2(out_fd, STDOUT_FILENO); }
-        execvp(argv[0], (char* const*)argv);
-        fprintf(stderr, "%ssolix: %s: command not found%s\n", ERROR_COLOR, argv[0], RESET_COLOR);
-        _exit(127);
-    } else if (pid<0){
-        perror("fork");
-        return 1;
+    struct stage *dst = arena_alloc(n * sizeof(struct stage));
+    for (int i=0; i<n; i++){
+        dst[i] = src[i];
+        if (src[i].redir_expand & EXPAND_IN) dst[i].in_file = expand_word((char *)src[i].in_file);
+        if (src[i].redir_expand & EXPAND_OUT) dst[i].out_file = expand_word((char *)src[i].out_file);
+        if (!src[i].expand) continue;
+        int argc = 0; while (src[i].argv[argc]) argc++;
+        dst[i].argv = arena_alloc((argc + 1) * sizeof(char *));
+        for (int a=0; a<=argc; a++)
+            dst[i].argv[a] = (a<argc && src[i].expand[a])? expand_word(src[i].argv[a]) : src[i].argv[a];
     }
-    int status; int w = waitpid(pid, &status, 0);
-    (void)w;
-    return WIFEXITED(status)? WEXITSTATUS(status) : 128+SIGINT;
+    return dst;
 }
 
-int exec_simple(char *const argv[], const char *in_file, const char *out_file, int append)
+/**
+ * Run one parsed pipeline and return its status
+ */
+static int execute_command(const struct command *cmd)
 {
-    int in_fd=-1, out_fd=-1; int rc;
-    if (in_file){ in_fd = open(in_file, O_RDONLY); if (in_fd<0){ perror("open in"); return 1; } }
-    if (out_file){ int flags = O_WRONLY|O_CREAT|(append?O_APPEND:O_TRUNC); out_fd = open(out_file, flags, 0644); if (out_fd<0){ perror("open out"); if(in_fd!=-1) close(in_fd); return 1; } }
-    if (is_builtin(argv[0]) && in_fd==-1 && out_fd==-1){
-        rc = exec_builtin(argv);
-    } else {
-        rc = exec_external(argv, in_fd, out_fd);
+    if (cmd->empty) return 0;
+    int background = (cmd->connector == TOK_BG);
+    struct stage *stages = cmd->expand? expand_stages(cmd->stages, cmd->nstages) : cmd->stages;
+    struct cmd_timer timer; struct cmd_times times;
+    int measure = (cmd->timed || profile_fd >= 0) && !background;
+    int status;
+    if (measure) timer_start(&timer);
+    if (cmd->nstages==1 && !background) status = exec_simple(stages[0].argv, stages[0].in_file, stages[0].out_file, stages[0].append);
+    else status = exec_pipeline(stages, cmd->nstages, background);
+    if (measure) {
+        timer_stop(&timer, &times);
+        if (cmd->timed) print_times(&times);
+        if (profile_fd >= 0) profile_log(stages, cmd->nstages, &times, status);
     }
-    if (in_fd!=-1) close(in_fd);
-    if (out_fd!=-1) close(out_fd);
-    return rc;
+    return status;
 }
 
-int exec_pipeline(char *const left_argv[], const char *left_in, char *const right_argv[], const char *right_out, int append)
+/**
+ * Walk a command list left to right
+ * After a && the next command runs only if the status is 0, after a ||
+ * only if it is not; a skipped command leaves the status alone, so
+ * `a && b || c` runs c when a fails. ; and & always run the next one.
+ */
+int execute_list(const struct cmd_list *list)
 {
-    int pipefd[2]; if (pipe(pipefd)<0){ perror("pipe"); return 1; }
-    pid_t c1 = fork();
-    if (c1==0){
-        signal(SIGINT, SIG_DFL);
-        // left process
-        int in_fd=-1; if (left_in){ in_fd=open(left_in,O_RDONLY); if(in_fd<0) _exit(1);} 
-        if (in_fd!=-1) dup2(in_fd, STDIN_FILENO);
-        dup2(pipefd[1], STDOUT_FILENO);
-        close(pipefd[0]); close(pipefd[1]); if(in_fd!=-1) close(in_fd);
-        if (is_builtin(left_argv[0])) _exit(exec_builtin(left_argv));
-        execvp(left_argv[0], (char* const*)left_argv);
-        _exit(127);
-    }
-    pid_t c2 = fork();
-    if (c2==0){
-        signal(SIGINT, SIG_DFL);
-        // right process
-        int out_fd=-1; if (right_out){ int flags=O_WRONLY|O_CREAT|(append?O_APPEND:O_TRUNC); out_fd=open(right_out,flags,0644); if(out_fd<0) _exit(1);} 
-        dup2(pipefd[0], STDIN_FILENO);
-        if (out_fd!=-1) dup2(out_fd, STDOUT_FILENO);
-        close(pipefd[0]); close(pipefd[1]); if(out_fd!=-1) close(out_fd);
-        if (is_builtin(right_argv[0])) _exit(exec_builtin(right_argv));
-        execvp(right_argv[0], (char* const*)right_argv);
-        _exit(127);
-    }
-    close(pipefd[0]); close(pipefd[1]);
-    int st1=0, st2=0; waitpid(c1,&st1,0); waitpid(c2,&st2,0);
-    return WIFEXITED(st2)? WEXITSTATUS(st2) : 128+SIGINT;
-}
-
-int execute_line_tokens(char *tokens[], int count)
-{
-    // chaining: left-to-right, short-circuit &&/||
-    int i=0; int status=0;
-    while (i<count) {
-        // gather command until next chain op
-        int start=i; int j=i; const char *chain_op=NULL;
-        int depth=0; // not used for now
-        for (; j<count; j++) {
-            if (strcmp(tokens[j],"&&")==0 || strcmp(tokens[j],"||")==0 || strcmp(tokens[j],";")==0) { chain_op=tokens[j]; break; }
-        }
-        int end=j; // [start,end)
-        // Execute segment [start,end)
-        // detect pipeline and redirs
-        int pipe_index=-1; int k;
-        for (k=start;k<end;k++) if (strcmp(tokens[k],"|")==0) { pipe_index=k; break; }
-        // split argv and redirs
-        char *in_file=NULL,*out_file=NULL; int append=0;
-        char *argv_left[MAX_TOKENS]; int al=0;
-        char *argv_right[MAX_TOKENS]; int ar=0;
-        if (pipe_index==-1){
-            for (k=start;k<end;k++){
-                if (strcmp(tokens[k],">")==0 || strcmp(tokens[k],">>")==0){ append = (tokens[k][1]=='>'); if (k+1<end) { out_file=tokens[k+1]; k++; } continue; }
-                if (strcmp(tokens[k],"<")==0){ if (k+1<end){ in_file=tokens[k+1]; k++; } continue; }
-                argv_left[al++] = tokens[k];
-            }
-            argv_left[al]=NULL;
-            if (al>0) status = exec_simple(argv_left, in_file, out_file, append); else status=0;
-        } else {
-            // left side
-            for (k=start;k<pipe_index;k++){
-                if (strcmp(tokens[k],"<")==0){ if (k+1<pipe_index){ in_file=tokens[k+1]; k++; } continue; }
-                argv_left[al++]=tokens[k];
-            }
-            argv_left[al]=NULL;
-            // right side
-            for (k=pipe_index+1;k<end;k++){
-                if (strcmp(tokens[k],">")==0 || strcmp(tokens[k],">>")==0){ append = (tokens[k][1]=='>'); if (k+1<end) { out_file=tokens[k+1]; k++; } continue; }
-                argv_right[ar++]=tokens[k];
-            }
-            argv_right[ar]=NULL;
-            if (al>0 && ar>0) status = exec_pipeline(argv_left, in_file, argv_right, out_file, append); else status=0;
-        }
-        last_status = status;
-        // chain logic
-        if (!chain_op) break;
-        if (strcmp(chain_op,"&&")==0 && status!=0) { // skip to next after && segment
-            i = end+1; // skip op
-            // skip following segments separated by && until status short-circuit ends? We'll just proceed
-        } else if (strcmp(chain_op,"||")==0 && status==0) {
-            i = end+1;
-        } else {
-            i = end+1;
-        }
+    int run = 1;
+    for (int c=0; c<list->ncmds && running; c++){
+        const struct command *cmd = &list->cmds[c];
+        if (run) last_status = execute_command(cmd);
+        if (cmd->connector == TOK_AND) run = (last_status == 0);
+        else if (cmd->connector == TOK_OR) run = (last_status != 0);
+        else run = 1;
     }
     return last_status;
 }
 
 /**
- * Free command arguments
+ * Store command in the history ring (no file I/O)
+ * Entries are packed back to back in history_buf; an entry that would run
+ * past the end wraps to offset 0, and the oldest entries overlapping the
+ * space it needs are evicted.
  */
-void free_args(char **args) { (void)args; }
+static void history_store(const char *command, size_t len)
+{
+    size_t need = len + 1;
+    if (need > HISTORY_BUF_SIZE) { len = HISTORY_BUF_SIZE - 1; need = HISTORY_BUF_SIZE; }
+    size_t start = history_head;
+    size_t tail_from = HISTORY_BUF_SIZE; // wrapping also frees [history_head, end)
+    if (start + need > HISTORY_BUF_SIZE) { tail_from = start; start = 0; }
+
+    while (history_len > 0) {
+        struct history_entry *o = &history_ents[history_first];
+        size_t o_end = o->off + o->len + 1;
+        int overlaps = (o->off < start + need && start < o_end) || o_end > tail_from;
+        if (history_len < HISTORY_SIZE && !overlaps) break;
+        history_first = (history_first + 1) % HISTORY_SIZE;
+        history_len--;
+    }
+
+    struct history_entry *e = &history_ents[(history_first + history_len) % HISTORY_SIZE];
+    e->off = (unsigned)start; e->len = (unsigned)len;
+    memcpy(history_buf + start, command, len);
+    history_buf[start + len] = '\0';
+    history_head = start + need;
+    history_len++;
+    history_count++;
+}
 
 /**
  * Add command to history
+ * The command is appended to the history file right away with one write.
  */
 void add_to_history(const char *command)
 {
-    if (strlen(command) == 0)
+    size_t len = strlen(command);
+    if (len == 0)
         return;
 
-    int index = history_count % HISTORY_SIZE;
-    strncpy(command_history[index], command, MAX_CMD_LEN - 1);
-    command_history[index][MAX_CMD_LEN - 1] = '\0';
-    history_count++;
+    history_store(command, len);
+
+    if (history_fd < 0) return;
+    struct iovec iov[2] = { { (void *)command, len }, { (void *)"\n", 1 } };
+    if (writev_all(history_fd, iov, 2) == 0) history_file_size += len + 1;
+    if (history_file_size > HISTORY_FILE_MAX) compact_history();
 }
 
 /**
@@ -373,11 +1616,12 @@ void signal_handler(int sig)
     switch (sig)
     {
     case SIGINT:
-        printf("\n");
+        write_all(STDOUT_FILENO, "\n", 1);
         last_status = 130;
+        got_sigint = 1;
         break;
     case SIGTERM:
-        printf("\n%sShell terminating...%s\n", INFO_COLOR, RESET_COLOR);
+        write_all(STDOUT_FILENO, "\n" INFO_COLOR "Shell terminating..." RESET_COLOR "\n", sizeof("\n" INFO_COLOR "Shell terminating..." RESET_COLOR "\n") - 1);
         running = 0;
         break;
     }
@@ -391,6 +1635,35 @@ void setup_signals(void)
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     signal(SIGQUIT, SIG_IGN); // Ignore quit signal
+    // reap children as they change state; SA_RESTART keeps the prompt read going
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sigchld_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGCHLD, &sa, NULL);
+}
+
+/**
+ * Take control of the terminal when running interactively on a tty
+ * Job control stays off (no process groups) for scripts, piped input and
+ * consoles that are not a controlling terminal, e.g. the shell as PID 1.
+ */
+static void init_job_control(void)
+{
+    if (!isatty(STDIN_FILENO)) return;
+    pid_t fg;
+    // started in the background: wait until we are put in the foreground
+    while ((fg = tcgetpgrp(STDIN_FILENO)) >= 0 && fg != getpgrp()) kill(-getpgrp(), SIGTTIN);
+    if (fg < 0) return;
+    shell_pgid = getpid();
+    if (getpgrp() != shell_pgid && setpgid(0, shell_pgid) < 0) { perror("solix: setpgid"); return; }
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGTTIN, SIG_IGN);
+    signal(SIGTTOU, SIG_IGN);
+    tcsetpgrp(STDIN_FILENO, shell_pgid);
+    tcgetattr(STDIN_FILENO, &shell_tmodes);
+    job_control = 1;
 }
 
 static const char *get_history_path(void)
@@ -401,26 +1674,71 @@ static const char *get_history_path(void)
     return history_path;
 }
 
-void load_history(void)
+/**
+ * Rewrite the history file from the in-memory ring
+ * Written to a temporary file and renamed into place, then reopened for append.
+ */
+void compact_history(void)
 {
-    FILE *f = fopen(get_history_path(), "r"); if (!f) return;
-    char line[MAX_CMD_LEN];
-    while (fgets(line, sizeof(line), f)) {
-        size_t len = strlen(line); if (len && line[len-1]=='\n') line[len-1]='\0';
-        add_to_history(line);
+    char tmp[sizeof(history_path) + 8];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", history_path);
+    int fd = open(tmp, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0600);
+    if (fd < 0) return;
+    struct iovec *iov = arena_alloc((size_t)(2 * history_len + 1) * sizeof(*iov));
+    int cnt = 0; size_t size = 0;
+    for (int i = 0; i < history_len; i++) {
+        struct history_entry *e = &history_ents[(history_first + i) % HISTORY_SIZE];
+        iov[cnt].iov_base = history_buf + e->off; iov[cnt++].iov_len = e->len;
+        iov[cnt].iov_base = (void *)"\n"; iov[cnt++].iov_len = 1;
+        size += e->len + 1;
+    }
+    if (writev_all(fd, iov, cnt) != 0 || close(fd) != 0 || rename(tmp, history_path) != 0) {
+        unlink(tmp);
+        return;
     }
-    fclose(f);
+    if (history_fd >= 0) close(history_fd);
+    history_fd = open(history_path, O_WRONLY|O_APPEND|O_CREAT|O_CLOEXEC, 0600);
+    history_file_size = size;
 }
 
-void save_history(void)
+/**
+ * Load the last HISTORY_SIZE entries and open the file for appending
+ * The file is mapped and scanned backwards from the end, so startup cost
+ * depends on the retained tail, not on how large the file has grown.
+ */
+void load_history(void)
 {
-    FILE *f = fopen(get_history_path(), "a"); if (!f) return;
-    int start = (history_count>HISTORY_SIZE)? history_count - HISTORY_SIZE : 0;
-    for (int i=start;i<history_count;i++) {
-        int idx = i % HISTORY_SIZE;
-        fprintf(f, "%s\n", command_history[idx]);
+    history_fd = open(get_history_path(), O_RDWR|O_APPEND|O_CREAT|O_CLOEXEC, 0600);
+    if (history_fd < 0) return;
+    struct stat st;
+    if (fstat(history_fd, &st) != 0 || st.st_size == 0) return;
+    history_file_size = (size_t)st.st_size;
+
+    char *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, history_fd, 0);
+    if (map == MAP_FAILED) return;
+    const char *end = map + st.st_size;
+    const char *p = end;
+    if (p > map && p[-1] == '\n') p--;
+    int lines = 0; size_t bytes = 0;
+    while (p > map && lines < HISTORY_SIZE) {
+        const char *nl = memrchr(map, '\n', (size_t)(p - map));
+        const char *line = nl ? nl + 1 : map;
+        if (bytes + (size_t)(p - line) + 1 > HISTORY_BUF_SIZE) break;
+        bytes += (size_t)(p - line) + 1;
+        if (p > line) lines++;
+        p = nl ? nl : map;
     }
-    fclose(f);
+    // p now sits at the newline (or start) before the retained tail
+    if (p > map) p++;
+    while (p < end) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        if (len) history_store(p, len);
+        p += len + 1;
+    }
+    munmap(map, (size_t)st.st_size);
+
+    if (history_file_size > HISTORY_FILE_MAX) compact_history();
 }
 
 // Built-in command implementations
@@ -451,6 +1769,8 @@ int builtin_cd(char **args)
         return 1;
     }
 
+    prompt_dirty = 1;
+
     return 0;
 }
 
@@ -463,7 +1783,7 @@ int builtin_pwd(char **args)
 
     if (getcwd(cwd, sizeof(cwd)) != NULL)
     {
-        printf("%s\n", cwd);
+        out_printf("%s\n", cwd);
     }
     else
     {
@@ -479,18 +1799,18 @@ int builtin_pwd(char **args)
  */
 int builtin_help(char **args)
 {
-    printf("%s", INFO_COLOR);
-    printf("Solix Shell - Built-in Commands:\n");
-    printf("================================\n\n");
+    out_printf("%s", INFO_COLOR);
+    out_puts("Solix Shell - Built-in Commands:\n");
+    out_puts("================================\n\n");
 
     for (int i = 0; builtin_commands[i].name != NULL; i++)
     {
-        printf("  %-12s - %s\n", builtin_commands[i].name, builtin_commands[i].description);
+        out_printf("  %-12s - %s\n", builtin_commands[i].name, builtin_commands[i].description);
     }
 
-    printf("\nExternal programs can also be executed by typing their name.\n");
-    printf("Use Ctrl+C to interrupt running programs.\n");
-    printf("Use 'exit' to quit the shell.\n%s", RESET_COLOR);
+    out_puts("\nExternal programs can also be executed by typing their name.\n");
+    out_puts("Use Ctrl+C to interrupt running programs.\n");
+    out_printf("Use 'exit' to quit the shell.\n%s", RESET_COLOR);
 
     return 0;
 }
@@ -507,7 +1827,7 @@ int builtin_exit(char **args)
         exit_code = atoi(args[1]);
     }
 
-    printf("%sGoodbye from Solix!%s\n", INFO_COLOR, RESET_COLOR);
+    if (interactive) out_printf("%sGoodbye from Solix!%s\n", INFO_COLOR, RESET_COLOR);
     running = 0;
     return exit_code;
 }
@@ -517,8 +1837,8 @@ int builtin_exit(char **args)
  */
 int builtin_clear(char **args)
 {
-    printf("\033[2J\033[H"); // ANSI escape codes to clear screen and move cursor to top
-    fflush(stdout);
+    out_puts("\033[2J\033[H"); // ANSI escape codes to clear screen and move cursor to top
+    out_flush();
     return 0;
 }
 
@@ -529,69 +1849,242 @@ int builtin_echo(char **args)
 {
     for (int i = 1; args[i] != NULL; i++)
     {
-        printf("%s", args[i]);
+        out_puts(args[i]);
         if (args[i + 1] != NULL)
         {
-            printf(" ");
+            out_write(" ", 1);
         }
     }
-    printf("\n");
+    out_write("\n", 1);
     return 0;
 }
 
 /**
- * List directory contents command
+ * ls helpers
+ * Entries come straight from getdents64 into one contiguous array; d_type
+ * decides the colour, so a short listing stats only DT_UNKNOWN entries
+ * (fstatat relative to the directory fd). -F also marks executables and
+ * follows symlinks, which costs a stat per regular file and link. -l makes
+ * exactly one statx per entry. Output is batched in out_buf.
  */
-int builtin_ls(char **args)
+struct linux_dirent64
+{
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct ls_entry
+{
+    char *name;
+    unsigned char type;
+    mode_t mode;
+    nlink_t nlink;
+    uid_t uid;
+    gid_t gid;
+    off_t size;
+    time_t mtime;
+    int have_mode;
+};
+
+static struct ls_entry *ls_entries = NULL;
+static size_t ls_cap = 0;
+// Fill mode and (for -l) the remaining metadata with one stat call
+static int ls_stat(int dirfd, struct ls_entry *e, int flags)
+{
+#ifdef STATX_BASIC_STATS
+    struct statx sx;
+    if (statx(dirfd, e->name, flags, STATX_BASIC_STATS, &sx) != 0) return -1;
+    e->mode = sx.stx_mode; e->nlink = sx.stx_nlink; e->uid = sx.stx_uid; e->gid = sx.stx_gid;
+    e->size = (off_t)sx.stx_size; e->mtime = (time_t)sx.stx_mtime.tv_sec;
+#else
+    struct stat st;
+    if (fstatat(dirfd, e->name, &st, flags) != 0) return -1;
+    e->mode = st.st_mode; e->nlink = st.st_nlink; e->uid = st.st_uid; e->gid = st.st_gid;
+    e->size = st.st_size; e->mtime = st.st_mtime;
+#endif
+    e->have_mode = 1;
+    return 0;
+}
+
+static int ls_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct ls_entry *)a)->name, ((const struct ls_entry *)b)->name);
+}
+
+static void ls_mode_string(mode_t m, char *buf)
+{
+    buf[0] = S_ISDIR(m)?'d': S_ISLNK(m)?'l': S_ISCHR(m)?'c': S_ISBLK(m)?'b': S_ISFIFO(m)?'p': S_ISSOCK(m)?'s':'-';
+    const char *rwx = "rwxrwxrwx";
+    for (int i=0; i<9; i++) buf[i+1] = (m & (0400 >> i))? rwx[i] : '-';
+    if (m & S_ISUID) buf[3] = (m & S_IXUSR)? 's' : 'S';
+    if (m & S_ISGID) buf[6] = (m & S_IXGRP)? 's' : 'S';
+    if (m & S_ISVTX) buf[9] = (m & S_IXOTH)? 't' : 'T';
+    buf[10] = '\0';
+}
+
+static void ls_print_name(const struct ls_entry *e, int is_dir, int is_exec)
+{
+    if (is_dir) { out_puts(INFO_COLOR); out_puts(e->name); out_puts("/"); out_puts(RESET_COLOR); }
+    else if (is_exec) { out_puts(PROMPT_COLOR); out_puts(e->name); out_puts("*"); out_puts(RESET_COLOR); }
+    else out_puts(e->name);
+}
+
+static void ls_print_entry(int dirfd, struct ls_entry *e, int long_fmt, int classify)
 {
-    const char *dir_path = (args[1] != NULL) ? args[1] : ".";
-    DIR *dir;
-    struct dirent *entry;
-    struct stat file_stat;
-    char full_path[MAX_PATH_LEN];
+    if (!long_fmt) {
+        int is_dir = e->type == DT_DIR;
+        int is_exec = 0;
+        if (e->type == DT_UNKNOWN || (classify && (e->type == DT_REG || e->type == DT_LNK))) {
+            // -F follows links like stat() so a link to a directory shows as one
+            if (ls_stat(dirfd, e, classify? 0 : AT_SYMLINK_NOFOLLOW) == 0) {
+                is_dir = S_ISDIR(e->mode);
+                is_exec = classify && !is_dir && (e->mode & S_IXUSR);
+            }
+        }
+        ls_print_name(e, is_dir, is_exec);
+        out_puts("\t");
+        return;
+    }
 
-    dir = opendir(dir_path);
-    if (dir == NULL)
+    char line[128], mode[11], when[32];
+    if (ls_stat(dirfd, e, AT_SYMLINK_NOFOLLOW) != 0) { out_puts("?????????? ? ? ? ?            "); out_puts(e->name); out_puts("\n"); return; }
+    ls_mode_string(e->mode, mode);
+    struct tm tm;
+    if (localtime_r(&e->mtime, &tm)) strftime(when, sizeof(when), "%b %e %H:%M", &tm); else strcpy(when, "?");
+    snprintf(line, sizeof(line), "%s %3lu %4u %4u %10lld %s ", mode, (unsigned long)e->nlink,
+             (unsigned)e->uid, (unsigned)e->gid, (long long)e->size, when);
+    out_puts(line);
+    ls_print_name(e, S_ISDIR(e->mode), S_ISREG(e->mode) && (e->mode & S_IXUSR));
+    if (S_ISLNK(e->mode)) {
+        char target[MAX_PATH_LEN];
+        ssize_t n = readlinkat(dirfd, e->name, target, sizeof(target)-1);
+        if (n >= 0) { target[n] = '\0'; out_puts(" -> "); out_puts(target); }
+    }
+    out_puts("\n");
+}
+
+static int ls_dir(const char *dir_path, int show_all, int long_fmt, int classify)
+{
+    int dirfd = open(dir_path, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (dirfd < 0 && errno == ENOTDIR) {
+        // a plain file operand lists itself
+        struct ls_entry e = { (char *)dir_path, DT_UNKNOWN, 0, 0, 0, 0, 0, 0, 0 };
+        ls_print_entry(AT_FDCWD, &e, long_fmt, classify);
+        if (!long_fmt) out_puts("\n");
+        return 0;
+    }
+    if (dirfd < 0)
     {
         fprintf(stderr, "%sls: %s: %s%s\n", ERROR_COLOR, dir_path, strerror(errno), RESET_COLOR);
         return 1;
     }
 
-    while ((entry = readdir(dir)) != NULL)
-    {
-        // Skip hidden files unless explicitly requested
-        if (entry->d_name[0] == '.' && args[1] == NULL)
-        {
-            continue;
+    size_t count = 0;
+    char *buf = arena_alloc(LS_DENT_BUF);
+    for (;;) {
+        long n = syscall(SYS_getdents64, dirfd, buf, LS_DENT_BUF);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+            off += d->d_reclen;
+            // Skip hidden files unless explicitly requested
+            if (d->d_name[0] == '.' && !show_all) continue;
+            if (count == ls_cap) {
+                size_t ncap = ls_cap? ls_cap * 2 : 256;
+                struct ls_entry *ne = realloc(ls_entries, ncap * sizeof(*ne));
+                if (!ne) { perror("ls"); close(dirfd); return 1; }
+                ls_entries = ne; ls_cap = ncap;
+            }
+            struct ls_entry *e = &ls_entries[count++];
+            e->name = arena_strdup(d->d_name);
+            e->type = d->d_type;
+            e->have_mode = 0;
         }
+    }
 
-        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+    qsort(ls_entries, count, sizeof(*ls_entries), ls_cmp);
+    for (size_t i = 0; i < count; i++) ls_print_entry(dirfd, &ls_entries[i], long_fmt, classify);
+    if (!long_fmt) out_puts("\n");
+    close(dirfd);
+    return 0;
+}
 
-        if (stat(full_path, &file_stat) == 0)
-        {
-            // Print with different colors for different file types
-            if (S_ISDIR(file_stat.st_mode))
-            {
-                printf("%s%s/%s\t", INFO_COLOR, entry->d_name, RESET_COLOR);
-            }
-            else if (file_stat.st_mode & S_IXUSR)
-            {
-                printf("%s%s*%s\t", PROMPT_COLOR, entry->d_name, RESET_COLOR);
-            }
-            else
-            {
-                printf("%s\t", entry->d_name);
-            }
-        }
-        else
+/**
+ * List directory contents command
+ * Usage: ls [-a] [-l] [-F] [path...]
+ */
+int builtin_ls(char **args)
+{
+    int show_all = 0, long_fmt = 0, classify = 0, npaths = 0, rc = 0;
+    for (int i = 1; args[i] != NULL; i++)
+    {
+        if (args[i][0] != '-' || !args[i][1]) { npaths++; continue; }
+        for (const char *f = args[i] + 1; *f; f++)
         {
-            printf("%s\t", entry->d_name);
+            if (*f == 'a') show_all = 1;
+            else if (*f == 'l') long_fmt = 1;
+            else if (*f == 'F') classify = 1;
+            else { fprintf(stderr, "%sls: invalid option -- '%c'%s\n", ERROR_COLOR, *f, RESET_COLOR); return 1; }
         }
     }
 
-    printf("\n");
-    closedir(dir);
-    return 0;
+    if (npaths == 0)
+    {
+        rc = ls_dir(".", show_all, long_fmt, classify);
+    }
+    for (int i = 1, seen = 0; args[i] != NULL; i++)
+    {
+        if (args[i][0] == '-' && args[i][1]) continue;
+        if (npaths > 1) { if (seen++) out_puts("\n"); out_puts(args[i]); out_puts(":\n"); }
+        if (ls_dir(args[i], show_all, long_fmt, classify) != 0) rc = 1;
+    }
+    out_flush();
+    return rc;
+}
+
+/**
+ * Copy in_fd to out_fd until EOF with the cheapest mechanism available:
+ * copy_file_range between regular files, splice into a pipe, sendfile
+ * from a regular file, and a plain read/write loop for everything else
+ * (ttys, or when the kernel rejects the faster call).
+ */
+static int copy_fd(int in_fd, int out_fd)
+{
+    struct stat ist, ost; ssize_t n;
+    int in_reg = fstat(in_fd, &ist)==0 && S_ISREG(ist.st_mode);
+    if (fstat(out_fd, &ost)!=0) return -1;
+
+    if (in_reg && S_ISREG(ost.st_mode)) {
+        while ((n = copy_file_range(in_fd, NULL, out_fd, NULL, CAT_CHUNK_MAX, 0)) > 0) {}
+        if (n==0) return 0;
+        if (errno!=EINVAL && errno!=EXDEV && errno!=ENOSYS && errno!=EOPNOTSUPP && errno!=EBADF) return -1;
+    }
+    if (S_ISFIFO(ost.st_mode)) {
+        while ((n = splice(in_fd, NULL, out_fd, NULL, CAT_CHUNK_MAX, SPLICE_F_MOVE)) > 0 || (n<0 && errno==EINTR)) {}
+        if (n==0) return 0;
+        if (errno!=EINVAL && errno!=ENOSYS) return -1;
+    }
+    if (in_reg) {
+        while ((n = sendfile(out_fd, in_fd, NULL, CAT_CHUNK_MAX)) > 0 || (n<0 && errno==EINTR)) {}
+        if (n==0) return 0;
+        if (errno!=EINVAL && errno!=ENOSYS) return -1;
+    }
+
+    static char buf[CAT_BUF_SIZE];
+    for (;;) {
+        n = read(in_fd, buf, sizeof(buf));
+        if (n==0) return 0;
+        if (n<0) { if (errno==EINTR) continue; return -1; }
+        for (ssize_t off=0; off<n; ) {
+            ssize_t w = write(out_fd, buf+off, (size_t)(n-off));
+            if (w<0) { if (errno==EINTR) continue; return -1; }
+            off += w;
+        }
+    }
 }
 
 /**
@@ -605,25 +2098,28 @@ int builtin_cat(char **args)
         return 1;
     }
 
+    int rc = 0;
+    out_flush();
     for (int i = 1; args[i] != NULL; i++)
     {
-        FILE *file = fopen(args[i], "r");
-        if (file == NULL)
+        int fd = open(args[i], O_RDONLY|O_CLOEXEC);
+        if (fd < 0)
         {
             fprintf(stderr, "%scat: %s: %s%s\n", ERROR_COLOR, args[i], strerror(errno), RESET_COLOR);
+            rc = 1;
             continue;
         }
 
-        int c;
-        while ((c = fgetc(file)) != EOF)
+        if (copy_fd(fd, STDOUT_FILENO) < 0)
         {
-            putchar(c);
+            fprintf(stderr, "%scat: %s: %s%s\n", ERROR_COLOR, args[i], strerror(errno), RESET_COLOR);
+            rc = 1;
         }
 
-        fclose(file);
+        close(fd);
     }
 
-    return 0;
+    return rc;
 }
 
 /**
@@ -631,62 +2127,100 @@ int builtin_cat(char **args)
  */
 int builtin_history(char **args)
 {
-    int start = (history_count > HISTORY_SIZE) ? history_count - HISTORY_SIZE : 0;
-    int end = history_count;
-
-    printf("%sCommand History:%s\n", INFO_COLOR, RESET_COLOR);
-    for (int i = start; i < end; i++)
+    int start = history_count - history_len;
+
+    // header, then number/entry/newline per line, all in one writev
+    static const char header[] = INFO_COLOR "Command History:" RESET_COLOR "\n";
+    int cnt = 0;
+    struct iovec *iov = arena_alloc((size_t)(3 * history_len + 1) * sizeof(*iov));
+    char *nums = arena_alloc((size_t)history_len * 16);
+    iov[cnt].iov_base = (void *)header; iov[cnt++].iov_len = sizeof(header) - 1;
+    for (int i = 0; i < history_len; i++)
     {
-        int index = i % HISTORY_SIZE;
-        printf("%3d  %s\n", i + 1, command_history[index]);
+        struct history_entry *e = &history_ents[(history_first + i) % HISTORY_SIZE];
+        char *num = nums + (size_t)i * 16;
+        int n = snprintf(num, 16, "%3d  ", start + i + 1);
+        iov[cnt].iov_base = num; iov[cnt++].iov_len = (size_t)n;
+        iov[cnt].iov_base = history_buf + e->off; iov[cnt++].iov_len = e->len;
+        iov[cnt].iov_base = (void *)"\n"; iov[cnt++].iov_len = 1;
     }
+    out_flush();
+    writev_all(STDOUT_FILENO, iov, cnt);
 
     return 0;
 }
 
 /**
- * Uptime command
+ * Applets linked into this binary (see rootfs/utils/applets.h)
  */
-int builtin_uptime(char **args)
+static const struct applet applets[] = { SOLIX_APPLETS, {NULL, NULL} };
+
+static const struct applet *find_applet(const char *name)
 {
-    FILE *uptime_file = fopen("/proc/uptime", "r");
-    if (uptime_file)
-    {
-        double uptime_seconds;
-        if (fscanf(uptime_file, "%lf", &uptime_seconds) == 1)
-        {
-            int hours = (int)(uptime_seconds / 3600);
-            int minutes = (int)((uptime_seconds - hours * 3600) / 60);
-            int seconds = (int)(uptime_seconds - hours * 3600 - minutes * 60);
+    if (strcmp(name, "uptime") == 0) name = "uptime_lite";
+    for (int i = 0; applets[i].name; i++)
+        if (strcmp(applets[i].name, name) == 0) return &applets[i];
+    return NULL;
+}
 
-            printf("System uptime: %d hours, %d minutes, %d seconds\n",
-                   hours, minutes, seconds);
-        }
-        fclose(uptime_file);
-    }
-    else
-    {
-        // Fallback for systems without /proc/uptime
-        printf("Uptime information not available\n");
-    }
+/**
+ * Run an applet in-process: no fork, no exec. Our buffered output goes
+ * out first, and the applet's stdio and signal dispositions are undone
+ * afterwards so the shell is left as it was.
+ */
+static int run_applet(const struct applet *a, char **args)
+{
+    // applets may write into their argv (strtok); the words may belong
+    // to a cached parsed line, so each call gets its own copy
+    int argc = 0;
+    while (args[argc]) argc++;
+    char **copy = arena_alloc((argc + 1) * sizeof(char *));
+    for (int i=0; i<argc; i++) copy[i] = arena_strdup(args[i]);
+    copy[argc] = NULL;
+    args = copy;
+    struct sigaction old_int, old_term;
+    sigaction(SIGINT, NULL, &old_int);
+    sigaction(SIGTERM, NULL, &old_term);
+    out_flush();
+    int rc = a->main(argc, args);
+    fflush(stdout);
+    fflush(stderr);
+    sigaction(SIGINT, &old_int, NULL);
+    sigaction(SIGTERM, &old_term, NULL);
+    return rc;
+}
 
-    return 0;
+int builtin_applet(char **args)
+{
+    const struct applet *a = find_applet(args[0]);
+    return a ? run_applet(a, args) : 127;
+}
+
+/**
+ * Redirected applet: point fd 0/1 at the files for the duration of the
+ * call instead of spawning. Returns -1 if argv[0] is not an applet.
+ */
+int exec_applet_redir(char *const argv[], int in_fd, int out_fd)
+{
+    const struct applet *a = find_applet(argv[0]);
+    if (!a) return -1;
+    int saved_in = -1, saved_out = -1;
+    out_flush();
+    if (in_fd != -1) { saved_in = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10); dup2(in_fd, STDIN_FILENO); }
+    if (out_fd != -1) { saved_out = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10); dup2(out_fd, STDOUT_FILENO); }
+    int rc = run_applet(a, (char **)argv);
+    if (saved_in != -1) { dup2(saved_in, STDIN_FILENO); close(saved_in); }
+    if (saved_out != -1) { dup2(saved_out, STDOUT_FILENO); close(saved_out); }
+    return rc;
 }
 
 int builtin_which(char **args)
 {
     if (!args[1]) { fprintf(stderr, "which: missing operand\n"); return 1; }
-    const char *path = getenv("PATH"); if (!path) path = "/bin:/sbin:/usr/bin:/usr/sbin";
-    char buf[512];
     for (int i=1; args[i]; i++){
-        const char *p = path; int found=0;
-        while (*p){
-            const char *q = strchr(p, ':'); size_t len = q? (size_t)(q-p) : strlen(p);
-            snprintf(buf, sizeof(buf), "%.*s/%s", (int)len, p, args[i]);
-            if (access(buf, X_OK)==0){ printf("%s\n", buf); found=1; break; }
-            if (!q) break; p = q+1;
-        }
-        if (!found) last_status=1; else last_status=0;
+        const char *path = strchr(args[i], '/')? (access(args[i], X_OK)==0? args[i] : NULL) : hash_lookup(args[i], 0);
+        if (path) { out_printf("%s\n", path); last_status=0; }
+        else last_status=1;
     }
     return last_status;
 }
@@ -700,6 +2234,9 @@ int builtin_export(char **args)
         if (!eq || eq==args[i]) { fprintf(stderr, "export: invalid: %s\n", args[i]); rc=1; continue; }
         *eq='\0'; const char *name=args[i]; const char *val=eq+1;
         if (setenv(name, val, 1)!=0) { perror("export"); rc=1; }
+        else if (strcmp(name, "PATH")==0) hash_clear();
+        else if (strcmp(name, "USER")==0 || strcmp(name, "PS1")==0) prompt_dirty = 1;
+        else if (strncmp(name, "SOLIX_PROFILE", 13)==0) profile_update();
         *eq='=';
     }
     return rc;
@@ -708,10 +2245,321 @@ int builtin_export(char **args)
 int builtin_unset(char **args)
 {
     if (!args[1]) { fprintf(stderr, "unset: usage: unset VAR [VAR...]\n"); return 1; }
-    int rc=0; for (int i=1; args[i]; i++) if (unsetenv(args[i])!=0) { perror("unset"); rc=1; }
+    int rc=0;
+    for (int i=1; args[i]; i++){
+        if (unsetenv(args[i])!=0) { perror("unset"); rc=1; }
+        else if (strcmp(args[i], "PATH")==0) hash_clear();
+        else if (strcmp(args[i], "USER")==0 || strcmp(args[i], "PS1")==0) prompt_dirty = 1;
+        else if (strncmp(args[i], "SOLIX_PROFILE", 13)==0) profile_update();
+    }
+    return rc;
+}
+
+static void print_options(void)
+{
+    for (int i=0; shell_options[i].name; i++) out_printf("%-12s%s\n", shell_options[i].name, *shell_options[i].flag? "on" : "off");
+}
+
+int builtin_set(char **args)
+{
+    if (!args[1]) { print_options(); return 0; }
+    for (int i=1; args[i]; i++){
+        int on;
+        if (strcmp(args[i],"-o")==0) on=1;
+        else if (strcmp(args[i],"+o")==0) on=0;
+        else { fprintf(stderr, "set: invalid option: %s\n", args[i]); return 1; }
+        if (!args[i+1]) { print_options(); return 0; }
+        int k=0;
+        while (shell_options[k].name && strcmp(shell_options[k].name, args[i+1])!=0) k++;
+        if (!shell_options[k].name) { fprintf(stderr, "set: unknown option name: %s\n", args[i+1]); return 1; }
+        *shell_options[k].flag = on;
+        i++;
+    }
+    return 0;
+}
+
+int builtin_hash(char **args)
+{
+    if (!args[1]){
+        int any=0;
+        for (int b=0; b<CMD_HASH_BUCKETS; b++){
+            for (struct cmd_hash_entry *e = cmd_hash[b]; e; e = e->next){
+                if (!any) out_puts("hits\tcommand\n");
+                out_printf("%4d\t%s\n", e->hits, e->path); any=1;
+            }
+        }
+        if (!any) out_puts("hash: hash table empty\n");
+        return 0;
+    }
+    int rc=0;
+    for (int i=1; args[i]; i++){
+        if (strcmp(args[i], "-r")==0) { hash_clear(); continue; }
+        if (find_builtin(args[i])) continue;
+        if (!hash_lookup(args[i], 0)) { fprintf(stderr, "hash: %s: not found\n", args[i]); rc=1; }
+    }
+    return rc;
+}
+
+int builtin_jobs(char **args)
+{
+    (void)args;
+    sigset_t old; block_sigchld(&old);
+    update_jobs();
+    struct job **pp = &job_list;
+    while (*pp) {
+        struct job *j = *pp;
+        if (j->foreground) { pp = &j->next; continue; }
+        print_job(j); j->notify = 0;
+        if (job_is_done(j)) { *pp = j->next; free(j); continue; }
+        pp = &j->next;
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    return 0;
+}
+
+int builtin_fg(char **args)
+{
+    if (!job_control) { fprintf(stderr, "fg: no job control\n"); return 1; }
+    struct job *j = job_find(args[1], "fg");
+    if (!j) return 1;
+    out_printf("%s\n", j->cmd);
+    out_flush();
+    job_continue(j, 1);
+    return wait_for_job(j);
+}
+
+int builtin_bg(char **args)
+{
+    if (!job_control) { fprintf(stderr, "bg: no job control\n"); return 1; }
+    struct job *j = job_find(args[1], "bg");
+    if (!j) return 1;
+    job_continue(j, 0);
+    out_printf("[%d]%c %s &\n", j->id, job_mark(j), j->cmd);
+    return 0;
+}
+
+int builtin_wait(char **args)
+{
+    if (!args[1]){
+        int rc = wait_background(NULL);
+        job_notify();
+        return rc;
+    }
+    int rc = 0;
+    for (int i=1; args[i]; i++){
+        struct job *j = job_find(args[i], "wait");
+        if (!j) { rc = 127; continue; }
+        rc = wait_background(j);
+        if (rc) break; // interrupted
+        rc = job_status(j);
+        if (job_is_done(j)) { job_account(j); job_remove(j); }
+    }
+    return rc;
+}
+
+/**
+ * time as a pipeline stage (`a | time b`); a leading time is handled by
+ * the parser so that it covers the whole pipeline
+ */
+int builtin_time(char **args)
+{
+    struct cmd_timer timer; struct cmd_times times;
+    timer_start(&timer);
+    int rc = args[1]? exec_simple(args + 1, NULL, NULL, 0) : 0;
+    timer_stop(&timer, &times);
+    print_times(&times);
     return rc;
 }
 
+/**
+ * Return the next line from reader, or NULL at end of input
+ * The line is NUL-terminated in place and stays valid until the next call.
+ */
+static char *reader_next_line(struct line_reader *r)
+{
+    for (;;) {
+        char *nl = memchr(r->buf + r->pos, '\n', r->len - r->pos);
+        if (nl) {
+            char *line = r->buf + r->pos;
+            *nl = '\0'; r->pos = (size_t)(nl - r->buf) + 1;
+            return line;
+        }
+        if (r->eof) {
+            if (r->pos >= r->len) return NULL;
+            char *line = r->buf + r->pos;
+            r->buf[r->len] = '\0'; r->pos = r->len;
+            return line;
+        }
+        // keep the partial line, make room, refill
+        if (r->pos > 0) { memmove(r->buf, r->buf + r->pos, r->len - r->pos); r->len -= r->pos; r->pos = 0; }
+        if (r->len + 1 >= r->cap) {
+            char *nb = realloc(r->buf, r->cap * 2);
+            if (!nb) { perror("solix: read"); r->eof = 1; continue; }
+            r->buf = nb; r->cap *= 2;
+        }
+        ssize_t n = read(r->fd, r->buf + r->len, r->cap - r->len - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) r->eof = 1;
+        else r->len += (size_t)n;
+    }
+}
+
+/**
+ * Build the argv for one parallel item: every {} in the template is
+ * replaced by the item, or the item is appended if there is no {}
+ */
+static char **parallel_argv(char **tmpl, const char *item)
+{
+    int n = 0, used = 0;
+    while (tmpl[n]) n++;
+    char **argv = arena_alloc((n + 2) * sizeof(char *));
+    size_t ilen = strlen(item);
+    for (int a=0; a<n; a++){
+        const char *t = tmpl[a], *hit = strstr(t, "{}");
+        if (!hit) { argv[a] = tmpl[a]; continue; }
+        size_t cnt = 0;
+        for (const char *q = hit; q; q = strstr(q + 2, "{}")) cnt++;
+        char *o = arena_alloc(strlen(t) + cnt * ilen + 1); argv[a] = o;
+        for (const char *q = t; *q; ) {
+            if (q[0]=='{' && q[1]=='}') { memcpy(o, item, ilen); o += ilen; q += 2; }
+            else *o++ = *q++;
+        }
+        *o = '\0';
+        used = 1;
+    }
+    if (!used) argv[n++] = (char *)item;
+    argv[n] = NULL;
+    return argv;
+}
+
+/**
+ * parallel [-j N] cmd [args...] [::: item...]
+ * Runs cmd once per item (argument list after :::, else stdin lines) with
+ * at most N jobs at a time (default: online CPUs; never more than the
+ * items or PARALLEL_MAX_JOBS). Each job goes through
+ * the normal launch path with stdin on /dev/null and stdout captured in a
+ * memfd, which is copied out whole when the job finishes, so outputs never
+ * interleave. Returns 0 if every job succeeded, else the number of failed
+ * jobs (at most 100); ^C stops launching and interrupts running jobs.
+ */
+int builtin_parallel(char **args)
+{
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    int a = 1;
+    for (; args[a] && args[a][0]=='-' && args[a][1]=='j'; a++){
+        const char *v = args[a][2]? args[a] + 2 : args[++a];
+        char *end = NULL;
+        if (v) { errno = 0; jobs = strtol(v, &end, 10); }
+        if (!v || end==v || *end || errno || jobs <= 0) {
+            fprintf(stderr, "parallel: -j needs a positive number\nusage: parallel [-j N] cmd [args... {}] [::: item...]\n");
+            return 2;
+        }
+    }
+    if (!args[a] || strcmp(args[a], ":::")==0) { fprintf(stderr, "usage: parallel [-j N] cmd [args... {}] [::: item...]\n"); return 2; }
+    char **tmpl = &args[a];
+
+    // items: after ::: (which also ends the template), else one per stdin line
+    char **items = NULL; int nitems = 0, own_items = 0;
+    int sep = 0; while (tmpl[sep] && strcmp(tmpl[sep], ":::")!=0) sep++;
+    if (tmpl[sep]) {
+        items = &tmpl[sep + 1];
+        while (items[nitems]) nitems++;
+        char **t = arena_alloc((sep + 1) * sizeof(char *));
+        memcpy(t, tmpl, sep * sizeof(char *)); t[sep] = NULL; tmpl = t;
+    } else {
+        struct line_reader r = { STDIN_FILENO, malloc(SCRIPT_BUF_SIZE), SCRIPT_BUF_SIZE, 0, 0, 0 };
+        int cap = 64; items = malloc(cap * sizeof(char *)); own_items = 1;
+        char *line;
+        while (r.buf && items && (line = reader_next_line(&r)) != NULL) {
+            if (!*line) continue;
+            if (nitems == cap) { char **ni = realloc(items, (cap *= 2) * sizeof(char *)); if (!ni) break; items = ni; }
+            items[nitems++] = arena_strdup(line);
+        }
+        free(r.buf);
+        if (!items) { perror("parallel"); return 2; }
+    }
+
+    // no more slots than items: the scan and reap loops below walk all of them
+    if (jobs > nitems) jobs = nitems;
+    if (jobs > PARALLEL_MAX_JOBS) jobs = PARALLEL_MAX_JOBS;
+    if (jobs < 1) jobs = 1;
+    struct { struct job *j; int out; } *slot = malloc(jobs * sizeof(*slot));
+    if (!slot) { perror("parallel"); if (own_items) free(items); return 2; }
+    int devnull = open("/dev/null", O_RDONLY|O_CLOEXEC);
+    for (long k=0; k<jobs; k++) slot[k].j = NULL;
+    int next = 0, active = 0, failed = 0, interrupted = 0;
+    out_flush();
+
+    sigset_t set, old;
+    sigemptyset(&set); sigaddset(&set, SIGCHLD); sigaddset(&set, SIGINT);
+    sigprocmask(SIG_BLOCK, &set, &old);
+    got_sigint = 0;
+    while (active > 0 || (next < nitems && !got_sigint)) {
+        for (long k=0; k<jobs && next < nitems && !got_sigint; k++){
+            if (slot[k].j) continue;
+            struct stage st = { .argv = parallel_argv(tmpl, items[next++]) };
+            struct job *j = job_new(&st, 1, 1);
+            if (!j) { failed++; continue; }
+            j->worker = 1;
+            int out = memfd_create("parallel", MFD_CLOEXEC);
+            builtin_fn builtin = find_builtin(st.argv[0]);
+            if (builtin) job_add_proc(j, fork_command(NULL, st.argv, devnull, out, builtin, j));
+            else job_add_proc(j, launch_external(st.argv, devnull, out, j));
+            slot[k].j = j; slot[k].out = out; active++;
+        }
+        update_jobs();
+        int finished = 0;
+        for (long k=0; k<jobs; k++){
+            struct job *j = slot[k].j;
+            if (!j || !job_is_done(j)) continue;
+            if (slot[k].out >= 0) {
+                lseek(slot[k].out, 0, SEEK_SET);
+                copy_fd(slot[k].out, STDOUT_FILENO);
+                close(slot[k].out);
+            }
+            if (job_status(j) != 0) failed++;
+            job_account(j); job_remove(j);
+            slot[k].j = NULL; active--; finished = 1;
+        }
+        if (got_sigint && !interrupted) {
+            // workers may sit in their own process groups, away from the terminal's ^C
+            for (long k=0; k<jobs; k++) if (slot[k].j && slot[k].j->procs[0].pid > 0) kill(slot[k].j->procs[0].pid, SIGINT);
+            interrupted = 1;
+        }
+        if (!finished && (active == jobs || next >= nitems || got_sigint) && active > 0) sigsuspend(&old);
+    }
+    sigprocmask(SIG_SETMASK, &old, NULL);
+    if (devnull != -1) close(devnull);
+    free(slot);
+    if (own_items) free(items);
+    if (interrupted) return 130;
+    return failed > 100? 100 : failed;
+}
+
+/**
+ * Parse (or fetch from the parse cache) and execute one line
+ */
+int run_line(const char *line)
+{
+    struct cmd_list *list = parse_line(line);
+    if (list) last_status = execute_list(list);
+    return last_status;
+}
+
+/**
+ * Run every line from reader without prompts or history
+ */
+int run_script(struct line_reader *reader)
+{
+    char *line;
+    while (running && (line = reader_next_line(reader)) != NULL) {
+        arena_reset();
+        job_notify();
+        run_line(line);
+    }
+    return last_status;
+}
+
 /**
  * Main shell loop
  */
@@ -719,23 +2567,65 @@ int main(int argc, char *argv[])
 {
     char *line;
     int status = 0;
+    struct line_reader reader = { -1, NULL, 0, 0, 0, 0 };
+
+    // Invoked through an applet symlink (/bin/ps_lite -> shell)
+    const char *base = strrchr(argv[0], '/');
+    const struct applet *self = find_applet(base ? base + 1 : argv[0]);
+    if (self) return self->main(argc, argv);
+    builtin_hash_init();
+
+    // Non-interactive modes: -c "cmd" [name args...] or script file [args...]
+    if (argc > 1) {
+        interactive = 0;
+        if (strcmp(argv[1], "-c") == 0) {
+            if (argc < 3) { fprintf(stderr, "solix: -c: option requires an argument\n"); return 2; }
+            reader.len = strlen(argv[2]);
+            reader.cap = reader.len + 1;
+            reader.buf = malloc(reader.cap);
+            if (!reader.buf) { perror("solix"); return 2; }
+            memcpy(reader.buf, argv[2], reader.cap);
+            reader.eof = 1;
+            script_args = argv + 3; script_nargs = argc - 3;
+        } else {
+            reader.fd = open(argv[1], O_RDONLY|O_CLOEXEC);
+            if (reader.fd < 0) { fprintf(stderr, "solix: %s: %s\n", argv[1], strerror(errno)); return 127; }
+            reader.cap = SCRIPT_BUF_SIZE;
+            reader.buf = malloc(reader.cap);
+            if (!reader.buf) { perror("solix"); return 2; }
+            script_args = argv + 1; script_nargs = argc - 1;
+        }
+    }
 
     // Setup signal handlers
     setup_signals();
 
-    // Print banner
-    print_banner();
-
     // Set environment variables
     setenv("SHELL", "/bin/shell", 1);
-    setenv("PS1", "solix> ", 1);
+    setenv("PS1", DEFAULT_PS1, 0);
     if (!getenv("PATH")) setenv("PATH","/bin:/sbin:/usr/bin:/usr/sbin",1);
+    profile_update();
+
+    if (!interactive) {
+        status = run_script(&reader);
+        if (reader.fd != -1) close(reader.fd);
+        free(reader.buf);
+        out_flush();
+        return status;
+    }
+
+    init_job_control();
+
+    // Print banner
+    print_banner();
 
     load_history();
 
     // Main shell loop
     while (running)
     {
+        arena_reset();
+        job_notify();
         print_prompt();
 
         line = read_command();
@@ -753,18 +2643,11 @@ int main(int argc, char *argv[])
         // Add to history
         add_to_history(line);
 
-        // Tokenize, expand, and execute with chaining support
-        char *tokens[MAX_TOKENS];
-        int ntok = tokenize_command(line, tokens, MAX_TOKENS);
-        if (ntok>0){
-            expand_vars(tokens, ntok);
-            status = execute_line_tokens(tokens, ntok);
-            last_status = status;
-            free_tokens(tokens, ntok);
-        }
+        status = run_line(line);
     }
 
-    printf("\n%sExiting Solix shell...%s\n", INFO_COLOR, RESET_COLOR);
-    save_history();
+    out_printf("\n%sExiting Solix shell...%s\n", INFO_COLOR, RESET_COLOR);
+    out_flush();
+    if (history_fd >= 0) close(history_fd);
     return status;
-}
\ No newline at end of file
+}
@@ -0,0 +1,31 @@
+#ifndef SOLIX_APPLETS_H
+#define SOLIX_APPLETS_H
+
+/*
+ * Applets of the Solix multi-call binary
+ *
+ * Each *_lite.c exports <name>_main(). Built on its own it also gets a
+ * main(); built with -DSOLIX_MULTICALL (as part of /bin/shell) it does
+ * not, and is reached through this table instead: by argv[0] when the
+ * binary is invoked through a symlink, or in-process as a shell builtin.
+ * Applets must therefore return instead of calling exit(), and release
+ * fds, memory and signal handlers before returning.
+ */
+
+struct applet {
+    const char *name;
+    int (*main)(int argc, char *argv[]);
+};
+
+int uptime_lite_main(int argc, char *argv[]);
+int ps_lite_main(int argc, char *argv[]);
+int meminfo_lite_main(int argc, char *argv[]);
+int top_lite_main(int argc, char *argv[]);
+
+#define SOLIX_APPLETS \
+    { "uptime_lite", uptime_lite_main }, \
+    { "ps_lite", ps_lite_main }, \
+    { "meminfo_lite", meminfo_lite_main }, \
+    { "top_lite", top_lite_main }
+
+#endif
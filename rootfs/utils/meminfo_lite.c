@@ -1,24 +1,183 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include "proc_lite.h"
+#include "applets.h"
 
-int main(void) {
-    FILE *f = fopen("/proc/meminfo", "r");
-    if (!f) { perror("/proc/meminfo"); return 1; }
-    char line[256];
-    long memtotal=-1, memfree=-1, buffers=-1, cached=-1;
-    while (fgets(line, sizeof(line), f)) {
-        if (sscanf(line, "MemTotal: %ld", &memtotal)==1) continue;
-        if (sscanf(line, "MemFree: %ld", &memfree)==1) continue;
-        if (sscanf(line, "Buffers: %ld", &buffers)==1) continue;
-        if (sscanf(line, "Cached: %ld", &cached)==1) continue;
+/*
+ * meminfo_lite: report /proc/meminfo
+ *
+ * /proc/meminfo is read with one pread() and tokenized in place into
+ * (key, value) pairs; nothing is scanf'd. The static table below is the
+ * default report, -f picks any fields the kernel exports, -a all of them.
+ * With -w the same fd is re-read every interval.
+ *
+ * usage: meminfo_lite [-a | -f Key,Key...] [-k | -j] [-w seconds]
+ */
+
+#define MAX_FIELDS 128
+
+/* Default report: the numbers we alert on */
+static const char *const default_fields[] = {
+    "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached",
+    "Shmem", "Slab", "SReclaimable", "SUnreclaim",
+    "SwapTotal", "SwapFree", "SwapCached", "Dirty", "Committed_AS",
+    NULL
+};
+
+struct field {
+    const char *key;       /* points into buf, NUL-terminated */
+    unsigned long long value;
+    int kb;                /* value carries a kB unit */
+};
+
+static char buf[16384];
+static struct field fields[MAX_FIELDS];
+static int nfields;
+
+enum { OUT_TEXT, OUT_KV, OUT_JSON };
+
+/* Split "Key:   123 kB\n" lines in place; returns the field count or -1 */
+static int read_meminfo(int fd) {
+    ssize_t n = pread_all(fd, buf, sizeof(buf));
+    if (n <= 0) return -1;
+    nfields = 0;
+    char *p = buf;
+    while (*p && nfields < MAX_FIELDS) {
+        char *colon = strchr(p, ':');
+        char *nl = strchr(p, '\n');
+        if (!colon || (nl && colon > nl)) {
+            if (!nl) break;
+            p = nl + 1;
+            continue;
+        }
+        *colon = '\0';
+        struct field *f = &fields[nfields++];
+        f->key = p;
+        const char *v = colon + 1;
+        f->value = next_num(&v);
+        f->kb = (strncmp(v, " kB", 3) == 0);
+        if (!nl) break;
+        p = nl + 1;
     }
-    fclose(f);
-    if (memtotal>=0) printf("MemTotal: %ld kB\n", memtotal);
-    if (memfree>=0)  printf("MemFree:  %ld kB\n", memfree);
-    if (buffers>=0)  printf("Buffers:  %ld kB\n", buffers);
-    if (cached>=0)   printf("Cached:   %ld kB\n", cached);
-    return 0;
+    return nfields;
+}
+
+static const struct field *find_field(const char *key) {
+    for (int i = 0; i < nfields; i++)
+        if (strcmp(fields[i].key, key) == 0) return &fields[i];
+    return NULL;
+}
+
+static size_t emit(char *out, size_t cap, size_t len, int mode, int first, const struct field *f) {
+    switch (mode) {
+    case OUT_KV:
+        return len + (size_t)snprintf(out + len, cap - len, "%s=%llu\n", f->key, f->value);
+    case OUT_JSON:
+        return len + (size_t)snprintf(out + len, cap - len, "%s\"%s\":%llu", first ? "" : ",", f->key, f->value);
+    default:
+        return len + (size_t)snprintf(out + len, cap - len, "%-16s%12llu%s\n", f->key, f->value, f->kb ? " kB" : "");
+    }
+}
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: meminfo_lite [-a | -f Key,Key...] [-k | -j] [-w seconds]\n");
 }
 
+int meminfo_lite_main(int argc, char *argv[]) {
+    int mode = OUT_TEXT, all = 0;
+    stop = 0;
+    double interval = 0;
+    const char *sel[MAX_FIELDS + 1];
+    int nsel = 0;
+    char *list = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0) all = 1;
+        else if (strcmp(argv[i], "-k") == 0) mode = OUT_KV;
+        else if (strcmp(argv[i], "-j") == 0) mode = OUT_JSON;
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) list = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            interval = strtod(argv[++i], NULL);
+            if (interval <= 0) { usage(); return 2; }
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (list) {
+        for (char *tok = strtok(list, ","); tok && nsel < MAX_FIELDS; tok = strtok(NULL, ","))
+            if (*tok) sel[nsel++] = tok;
+    } else {
+        for (int i = 0; default_fields[i]; i++) sel[nsel++] = default_fields[i];
+    }
+    sel[nsel] = NULL;
+
+    int fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        perror("/proc/meminfo");
+        return 1;
+    }
+    if (interval > 0) {
+        signal(SIGINT, on_signal);
+        signal(SIGTERM, on_signal);
+    }
+
+    static char out[16384];
+    int rc = 0;
+    do {
+        if (read_meminfo(fd) < 0) {
+            perror("/proc/meminfo");
+            rc = 1;
+            break;
+        }
+        size_t len = 0;
+        if (mode == OUT_JSON) len += (size_t)snprintf(out, sizeof(out), "{");
+        int first = 1;
+        if (all) {
+            for (int i = 0; i < nfields; i++, first = 0) len = emit(out, sizeof(out), len, mode, first, &fields[i]);
+        } else {
+            for (int i = 0; i < nsel; i++) {
+                const struct field *f = find_field(sel[i]);
+                if (!f) {
+                    /* fields differ between kernels: skip defaults quietly, flag requested ones */
+                    if (list) { fprintf(stderr, "meminfo_lite: no field %s\n", sel[i]); rc = 1; }
+                    continue;
+                }
+                len = emit(out, sizeof(out), len, mode, first, f);
+                first = 0;
+            }
+        }
+        if (mode == OUT_JSON) len += (size_t)snprintf(out + len, sizeof(out) - len, "}\n");
+        else if (interval > 0 && mode == OUT_TEXT) len += (size_t)snprintf(out + len, sizeof(out) - len, "\n");
+        if (len > sizeof(out)) len = sizeof(out);
+        for (size_t off = 0; off < len; ) {
+            ssize_t w = write(STDOUT_FILENO, out + off, len - off);
+            if (w < 0) { if (errno == EINTR) continue; stop = 1; rc = 1; break; }
+            off += (size_t)w;
+        }
+        if (interval <= 0 || stop) break;
+        struct timespec ts = { (time_t)interval, (long)((interval - (double)(time_t)interval) * 1e9) };
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !stop) {}
+    } while (!stop);
+    close(fd);
+    return rc;
+}
 
+#ifndef SOLIX_MULTICALL
+int main(int argc, char *argv[]) {
+    return meminfo_lite_main(argc, argv);
+}
+#endif
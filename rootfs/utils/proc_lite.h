@@ -0,0 +1,128 @@
+#ifndef SOLIX_PROC_LITE_H
+#define SOLIX_PROC_LITE_H
+
+/*
+ * Shared /proc parsing for the *_lite utilities
+ *
+ * Files are read with one read()/pread() into a caller-provided buffer
+ * and parsed by hand; nothing here touches stdio or the heap.
+ */
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+struct proc_row {
+    int pid;
+    int ppid;
+    char state;
+    unsigned long long utime;     /* clock ticks */
+    unsigned long long stime;
+    unsigned long long starttime; /* ticks after boot */
+    unsigned long rss_kb;
+    char comm[64];
+};
+
+/* Re-read an fd kept open from offset 0; returns bytes read or -1 */
+static inline ssize_t pread_all(int fd, char *buf, size_t len) {
+    ssize_t n = pread(fd, buf, len - 1, 0);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+/* Read a small /proc file in one go; returns bytes read or -1 */
+static inline ssize_t read_at(int dirfd, const char *path, char *buf, size_t len) {
+    int fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    ssize_t n = read(fd, buf, len - 1);
+    close(fd);
+    if (n < 0) return -1;
+    buf[n] = '\0';
+    return n;
+}
+
+static inline unsigned long long next_num(const char **p) {
+    const char *s = *p;
+    while (*s == ' ') s++;
+    int neg = (*s == '-');
+    if (neg) s++;
+    unsigned long long v = 0;
+    while (*s >= '0' && *s <= '9') v = v * 10 + (unsigned)(*s++ - '0');
+    *p = s;
+    return neg ? 0 : v;
+}
+
+static inline void skip_fields(const char **p, int n) {
+    const char *s = *p;
+    while (n-- > 0) {
+        while (*s == ' ') s++;
+        while (*s && *s != ' ') s++;
+    }
+    *p = s;
+}
+
+static inline int is_pid(const char *s) {
+    if (!*s) return 0;
+    for (; *s; s++) if (*s < '0' || *s > '9') return 0;
+    return 1;
+}
+
+/*
+ * Parse "pid (comm) S ppid ... utime stime ... starttime vsize rss ..."
+ * comm may itself contain spaces and ')', so it ends at the last ')'.
+ */
+static inline int parse_stat(const char *buf, long page_kb, struct proc_row *r) {
+    const char *open = strchr(buf, '(');
+    const char *close = strrchr(buf, ')');
+    if (!open || !close || close < open || close[1] != ' ') return -1;
+    size_t clen = (size_t)(close - open - 1);
+    if (clen >= sizeof(r->comm)) clen = sizeof(r->comm) - 1;
+    memcpy(r->comm, open + 1, clen);
+    r->comm[clen] = '\0';
+
+    const char *p = close + 2;
+    r->state = *p++;
+    r->ppid = (int)next_num(&p);            /* field 4 */
+    skip_fields(&p, 9);                     /* pgrp .. cmajflt */
+    r->utime = next_num(&p);                /* field 14 */
+    r->stime = next_num(&p);                /* field 15 */
+    skip_fields(&p, 6);                     /* cutime .. itrealvalue */
+    r->starttime = next_num(&p);            /* field 22 */
+    skip_fields(&p, 1);                     /* vsize */
+    r->rss_kb = (unsigned long)next_num(&p) * (unsigned long)page_kb; /* field 24, pages */
+    return 0;
+}
+
+/* Value of a "Key:   123 kB" line in /proc/meminfo text, or 0 if absent */
+static inline unsigned long long meminfo_value(const char *buf, const char *key) {
+    size_t klen = strlen(key);
+    const char *p = buf;
+    while (p && *p) {
+        if (strncmp(p, key, klen) == 0 && p[klen] == ':') {
+            const char *v = p + klen + 1;
+            return next_num(&v);
+        }
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return 0;
+}
+
+/* Uptime in clock ticks from /proc/uptime text ("12345.67 ...") */
+static inline unsigned long long uptime_ticks(const char *buf, long hz) {
+    const char *p = buf;
+    unsigned long long t = next_num(&p) * (unsigned long long)hz;
+    if (*p == '.') { p++; t += next_num(&p) * (unsigned long long)hz / 100; }
+    return t;
+}
+
+#endif
@@ -1,51 +1,154 @@
 #define _GNU_SOURCE
 #include <stdio.h>
-#include <dirent.h>
+#include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "proc_lite.h"
+#include "applets.h"
 
-static int is_number(const char *s) {
-    if (!s || !*s) return 0;
-    for (; *s; ++s) if (!isdigit((unsigned char)*s)) return 0;
-    return 1;
+/*
+ * ps_lite: list processes from /proc
+ *
+ * Every /proc/<pid>/stat is read with openat() relative to one /proc
+ * dirfd and a single read() into a reused stack buffer, then parsed by
+ * hand: no stdio or heap traffic per process. Rows land in one
+ * contiguous array that --sort/--top work on.
+ *
+ * usage: ps_lite [--sort pid|ppid|rss|time|start|name] [--top N]
+ */
+
+static struct proc_row *rows;
+static size_t nrows, cap;
+
+static int scan_proc(int procfd, long page_kb) {
+    char dents[32768], path[32], buf[1024];
+    long n;
+    while ((n = syscall(SYS_getdents64, procfd, dents, sizeof(dents))) > 0) {
+        for (long off = 0; off < n; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(dents + off);
+            off += d->d_reclen;
+            if (!is_pid(d->d_name)) continue;
+            snprintf(path, sizeof(path), "%s/stat", d->d_name);
+            if (read_at(procfd, path, buf, sizeof(buf)) <= 0) continue; /* exited meanwhile */
+            if (nrows == cap) {
+                size_t ncap = cap ? cap * 2 : 512;
+                struct proc_row *nr = realloc(rows, ncap * sizeof(*rows));
+                if (!nr) { perror("ps_lite"); return -1; }
+                rows = nr;
+                cap = ncap;
+            }
+            struct proc_row *r = &rows[nrows];
+            r->pid = atoi(d->d_name);
+            if (parse_stat(buf, page_kb, r) == 0) nrows++;
+        }
+    }
+    if (n < 0) { perror("/proc"); return -1; }
+    return 0;
 }
 
-int main(void) {
-    DIR *proc = opendir("/proc");
-    if (!proc) {
-        perror("/proc");
-        return 1;
+static int sort_key;
+enum { SORT_PID, SORT_PPID, SORT_RSS, SORT_TIME, SORT_START, SORT_NAME };
+static const char *sort_names[] = { "pid", "ppid", "rss", "time", "start", "name", NULL };
+
+#define CMP(a, b) ((a) < (b) ? -1 : (a) > (b))
+
+/* rss and time sort biggest first; everything else ascending */
+static int row_cmp(const void *pa, const void *pb) {
+    const struct proc_row *a = pa, *b = pb;
+    int c = 0;
+    switch (sort_key) {
+    case SORT_PPID: c = CMP(a->ppid, b->ppid); break;
+    case SORT_RSS: c = CMP(b->rss_kb, a->rss_kb); break;
+    case SORT_TIME: c = CMP(b->utime + b->stime, a->utime + a->stime); break;
+    case SORT_START: c = CMP(a->starttime, b->starttime); break;
+    case SORT_NAME: c = strcmp(a->comm, b->comm); break;
+    default: break;
     }
-    struct dirent *de;
-    printf("  PID  CMD\n");
-    while ((de = readdir(proc)) != NULL) {
-        if (!is_number(de->d_name)) continue;
-        char path[256];
-        snprintf(path, sizeof(path), "/proc/%s/comm", de->d_name);
-        FILE *f = fopen(path, "r");
-        char name[256] = {0};
-        if (f) {
-            if (fgets(name, sizeof(name), f)) {
-                size_t len = strlen(name);
-                if (len && name[len-1]=='\n') name[len-1]='\0';
-            }
-            fclose(f);
+    return c ? c : CMP(a->pid, b->pid);
+}
+
+static void fmt_ticks(char *out, size_t len, unsigned long long ticks, long hz) {
+    unsigned long long s = ticks / (unsigned long long)hz;
+    if (s >= 86400)
+        snprintf(out, len, "%llu-%02llu:%02llu:%02llu", s / 86400, s / 3600 % 24, s / 60 % 60, s % 60);
+    else if (s >= 3600)
+        snprintf(out, len, "%02llu:%02llu:%02llu", s / 3600, s / 60 % 60, s % 60);
+    else
+        snprintf(out, len, "%02llu:%02llu", s / 60, s % 60);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: ps_lite [--sort pid|ppid|rss|time|start|name] [--top N]\n");
+}
+
+int ps_lite_main(int argc, char *argv[]) {
+    long top = -1;
+    sort_key = SORT_PID;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--sort") == 0 && i + 1 < argc) {
+            int k = 0;
+            while (sort_names[k] && strcmp(sort_names[k], argv[i + 1]) != 0) k++;
+            if (!sort_names[k]) { usage(); return 2; }
+            sort_key = k;
+            i++;
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            char *end;
+            errno = 0;
+            top = strtol(argv[++i], &end, 10);
+            if (end == argv[i] || *end || errno || top < 0) { usage(); return 2; }
         } else {
-            snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
-            f = fopen(path, "r");
-            if (f) {
-                int pid; char comm[256]; char state;
-                if (fscanf(f, "%d (%255[^)]) %c", &pid, comm, &state)==3) {
-                    strncpy(name, comm, sizeof(name)-1);
-                }
-                fclose(f);
-            }
+            usage();
+            return 2;
         }
-        if (name[0])
-            printf("%5s  %s\n", de->d_name, name);
     }
-    closedir(proc);
+
+    int procfd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procfd < 0) {
+        perror("/proc");
+        return 1;
+    }
+    long hz = sysconf(_SC_CLK_TCK);
+    if (hz <= 0) hz = 100;
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (page_kb <= 0) page_kb = 4;
+
+    char buf[128];
+    unsigned long long now_ticks = 0;
+    if (read_at(procfd, "uptime", buf, sizeof(buf)) > 0) now_ticks = uptime_ticks(buf, hz);
+
+    int rc = scan_proc(procfd, page_kb);
+    close(procfd);
+    if (rc < 0) {
+        free(rows);
+        rows = NULL;
+        nrows = cap = 0;
+        return 1;
+    }
+    if (sort_key != SORT_PID || top >= 0) qsort(rows, nrows, sizeof(*rows), row_cmp);
+
+    size_t shown = (top >= 0 && (size_t)top < nrows) ? (size_t)top : nrows;
+    printf("  PID  PPID S    RSS(KB)      TIME    ELAPSED  CMD\n");
+    for (size_t i = 0; i < shown; i++) {
+        const struct proc_row *r = &rows[i];
+        char cpu[32], elapsed[32];
+        fmt_ticks(cpu, sizeof(cpu), r->utime + r->stime, hz);
+        fmt_ticks(elapsed, sizeof(elapsed), now_ticks > r->starttime ? now_ticks - r->starttime : 0, hz);
+        printf("%5d %5d %c %10lu %9s %10s  %s\n", r->pid, r->ppid, r->state, r->rss_kb, cpu, elapsed, r->comm);
+    }
+    fflush(stdout);
+    free(rows);
+    rows = NULL;
+    nrows = cap = 0;
     return 0;
 }
 
-
+#ifndef SOLIX_MULTICALL
+int main(int argc, char *argv[]) {
+    static char obuf[65536];
+    setvbuf(stdout, obuf, _IOFBF, sizeof(obuf));
+    return ps_lite_main(argc, argv);
+}
+#endif
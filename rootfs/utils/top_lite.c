@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "proc_lite.h"
+#include "applets.h"
+
+/*
+ * top_lite: live process monitor
+ *
+ * /proc/stat, /proc/meminfo, /proc/loadavg, /proc/uptime and every
+ * /proc/<pid>/stat stay open between refreshes and are re-read with
+ * pread(fd, ..., 0); only new PIDs cost an openat. CPU usage is the
+ * delta since the previous refresh, per process and per CPU. Each frame
+ * is diffed against the last one and only changed lines are redrawn,
+ * which keeps a 115200 baud serial console usable.
+ *
+ * usage: top_lite [-d seconds] [-n iterations]
+ */
+
+#define MAX_CPUS 256
+#define MAX_LINES 128
+#define LINE_W 256
+
+struct tproc {
+    int pid;
+    int fd;                 /* /proc/<pid>/stat, -1 if it could not stay open */
+    unsigned long long prev; /* utime+stime at the previous sample */
+    double cpu;             /* % of one CPU since the previous sample */
+    struct proc_row row;
+};
+
+struct cpu_sample {
+    unsigned long long busy, total;
+};
+
+static struct tproc *procs, *spare;
+static struct tproc **order;
+static size_t nprocs, pcap; /* procs, spare and order share one capacity */
+static int *pids;
+static size_t pids_cap;
+
+static struct cpu_sample cpu_prev[MAX_CPUS + 1], cpu_cur[MAX_CPUS + 1];
+static int ncpus;
+static unsigned procs_running;
+
+static char frame[2][MAX_LINES][LINE_W];
+static int frame_lines[2];
+static int cur_frame;
+static int first_frame = 1;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static int grow(void **ptr, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 0;
+    size_t ncap = *cap ? *cap : 256;
+    while (ncap < need) ncap *= 2;
+    void *n = realloc(*ptr, ncap * elem);
+    if (!n) return -1;
+    *ptr = n;
+    *cap = ncap;
+    return 0;
+}
+
+static int grow_tables(size_t need) {
+    if (need <= pcap) return 0;
+    size_t ncap = pcap ? pcap : 256;
+    while (ncap < need) ncap *= 2;
+    struct tproc *a = realloc(procs, ncap * sizeof(*procs));
+    if (!a) return -1;
+    procs = a;
+    struct tproc *b = realloc(spare, ncap * sizeof(*spare));
+    if (!b) return -1;
+    spare = b;
+    struct tproc **c = realloc(order, ncap * sizeof(*order));
+    if (!c) return -1;
+    order = c;
+    pcap = ncap;
+    return 0;
+}
+
+static int int_cmp(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Current PIDs in ascending order; one getdents64 pass over the kept dirfd */
+static size_t list_pids(int procfd) {
+    char dents[32768];
+    size_t n = 0;
+    int sorted = 1;
+    long got;
+    lseek(procfd, 0, SEEK_SET);
+    while ((got = syscall(SYS_getdents64, procfd, dents, sizeof(dents))) > 0) {
+        for (long off = 0; off < got; ) {
+            struct linux_dirent64 *d = (struct linux_dirent64 *)(dents + off);
+            off += d->d_reclen;
+            if (!is_pid(d->d_name)) continue;
+            if (n == pids_cap && grow((void **)&pids, &pids_cap, n + 1, sizeof(int)) < 0) return n;
+            pids[n] = atoi(d->d_name);
+            if (n && pids[n] < pids[n - 1]) sorted = 0;
+            n++;
+        }
+    }
+    if (!sorted) qsort(pids, n, sizeof(int), int_cmp);
+    return n;
+}
+
+/*
+ * Merge the fresh PID list into the tracked table: exited PIDs lose their
+ * fd, surviving ones keep it, new ones are opened once.
+ */
+static int refresh_procs(int procfd, long page_kb, long hz, double dt) {
+    size_t np = list_pids(procfd);
+    if (grow_tables(np) < 0) return -1;
+
+    size_t i = 0, out = 0;
+    char buf[1024], path[32];
+    for (size_t k = 0; k < np; k++) {
+        while (i < nprocs && procs[i].pid < pids[k]) {
+            if (procs[i].fd >= 0) close(procs[i].fd);
+            i++;
+        }
+        struct tproc t;
+        int fresh = 1;
+        if (i < nprocs && procs[i].pid == pids[k]) {
+            t = procs[i++];
+            fresh = 0;
+        } else {
+            t.pid = pids[k];
+            snprintf(path, sizeof(path), "%d/stat", t.pid);
+            t.fd = openat(procfd, path, O_RDONLY | O_CLOEXEC);
+            t.prev = 0;
+        }
+        ssize_t n = t.fd >= 0 ? pread_all(t.fd, buf, sizeof(buf)) : -1;
+        if (t.fd < 0) {
+            /* out of fds: fall back to open/read/close for this one */
+            snprintf(path, sizeof(path), "%d/stat", t.pid);
+            n = read_at(procfd, path, buf, sizeof(buf));
+        }
+        if (n <= 0 || parse_stat(buf, page_kb, &t.row) < 0) { /* exited meanwhile */
+            if (t.fd >= 0) close(t.fd);
+            continue;
+        }
+        t.row.pid = t.pid;
+        unsigned long long ticks = t.row.utime + t.row.stime;
+        t.cpu = (fresh || dt <= 0) ? 0.0 : (double)(ticks - t.prev) * 100.0 / ((double)hz * dt);
+        t.prev = ticks;
+        spare[out++] = t;
+    }
+    for (; i < nprocs; i++) if (procs[i].fd >= 0) close(procs[i].fd);
+
+    struct tproc *swap = procs;
+    procs = spare;
+    spare = swap;
+    nprocs = out;
+    return 0;
+}
+
+/* "cpu" aggregate goes in slot 0, cpuN in slot N+1 */
+static void read_cpus(int statfd) {
+    static char buf[65536];
+    if (pread_all(statfd, buf, sizeof(buf)) <= 0) return;
+    ncpus = 0;
+    procs_running = 0;
+    const char *p = buf;
+    while (p && *p) {
+        if (strncmp(p, "cpu", 3) == 0) {
+            const char *q = p + 3;
+            int slot = 0;
+            if (*q >= '0' && *q <= '9') slot = (int)next_num(&q) + 1;
+            if (slot <= MAX_CPUS) {
+                unsigned long long v[8] = {0};
+                for (int f = 0; f < 8; f++) v[f] = next_num(&q);
+                unsigned long long total = 0;
+                for (int f = 0; f < 8; f++) total += v[f];
+                cpu_cur[slot].total = total;
+                cpu_cur[slot].busy = total - v[3] - v[4]; /* minus idle and iowait */
+                if (slot > ncpus) ncpus = slot;
+            }
+        } else if (strncmp(p, "procs_running ", 14) == 0) {
+            const char *q = p + 14;
+            procs_running = (unsigned)next_num(&q);
+        }
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+}
+
+static double cpu_pct(int slot) {
+    unsigned long long dt = cpu_cur[slot].total - cpu_prev[slot].total;
+    unsigned long long db = cpu_cur[slot].busy - cpu_prev[slot].busy;
+    return dt ? (double)db * 100.0 / (double)dt : 0.0;
+}
+
+static int proc_cmp(const void *a, const void *b) {
+    const struct tproc *x = *(struct tproc *const *)a, *y = *(struct tproc *const *)b;
+    if (x->cpu != y->cpu) return x->cpu < y->cpu ? 1 : -1;
+    if (x->row.rss_kb != y->row.rss_kb) return x->row.rss_kb < y->row.rss_kb ? 1 : -1;
+    return (x->pid > y->pid) - (x->pid < y->pid);
+}
+
+static char *line(int n) {
+    return frame[cur_frame][n];
+}
+
+/* Emit the lines that differ from the previous frame in one write */
+static void flush_frame(int nlines, int width) {
+    static char out[MAX_LINES * (LINE_W + 16) + 32];
+    size_t len = 0;
+    int prev = cur_frame ^ 1;
+    if (first_frame) {
+        memcpy(out, "\033[H\033[2J", 7);
+        len = 7;
+    }
+    for (int i = 0; i < nlines || i < frame_lines[prev]; i++) {
+        const char *l = i < nlines ? frame[cur_frame][i] : "";
+        if (!first_frame && i < frame_lines[prev] && strcmp(l, frame[prev][i]) == 0) continue;
+        len += (size_t)snprintf(out + len, sizeof(out) - len, "\033[%d;1H%.*s\033[K", i + 1, width, l);
+    }
+    len += (size_t)snprintf(out + len, sizeof(out) - len, "\033[%d;1H", nlines + 1);
+    for (size_t off = 0; off < len; ) {
+        ssize_t w = write(STDOUT_FILENO, out + off, len - off);
+        if (w < 0) { if (errno == EINTR) continue; break; }
+        off += (size_t)w;
+    }
+    frame_lines[cur_frame] = nlines;
+    cur_frame ^= 1;
+    first_frame = 0;
+}
+
+static void fmt_secs(char *out, size_t len, unsigned long long s) {
+    if (s >= 86400)
+        snprintf(out, len, "%llud %02llu:%02llu:%02llu", s / 86400, s / 3600 % 24, s / 60 % 60, s % 60);
+    else
+        snprintf(out, len, "%02llu:%02llu:%02llu", s / 3600, s / 60 % 60, s % 60);
+}
+
+/* Drop all per-run state so the applet can run again in the same process */
+static void reset_state(void) {
+    for (size_t i = 0; i < nprocs; i++) if (procs[i].fd >= 0) close(procs[i].fd);
+    free(procs);
+    free(spare);
+    free(order);
+    free(pids);
+    procs = spare = NULL;
+    order = NULL;
+    pids = NULL;
+    nprocs = pcap = pids_cap = 0;
+    memset(cpu_prev, 0, sizeof(cpu_prev));
+    ncpus = 0;
+    frame_lines[0] = frame_lines[1] = 0;
+    cur_frame = 0;
+    first_frame = 1;
+    stop = 0;
+}
+
+int top_lite_main(int argc, char *argv[]) {
+    double delay = 1.0;
+    long iterations = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) delay = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) iterations = strtol(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "usage: top_lite [-d seconds] [-n iterations]\n");
+            return 2;
+        }
+    }
+    if (delay < 0.1) delay = 0.1;
+
+    int procfd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (procfd < 0) {
+        perror("/proc");
+        return 1;
+    }
+    int statfd = openat(procfd, "stat", O_RDONLY | O_CLOEXEC);
+    int memfd = openat(procfd, "meminfo", O_RDONLY | O_CLOEXEC);
+    int loadfd = openat(procfd, "loadavg", O_RDONLY | O_CLOEXEC);
+    int upfd = openat(procfd, "uptime", O_RDONLY | O_CLOEXEC);
+
+    /* one fd per process: lift the soft limit as far as allowed */
+    struct rlimit rl, saved_rl;
+    int raised = 0;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+        saved_rl = rl;
+        rl.rlim_cur = rl.rlim_max;
+        raised = (setrlimit(RLIMIT_NOFILE, &rl) == 0);
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    long hz = sysconf(_SC_CLK_TCK);
+    if (hz <= 0) hz = 100;
+    long page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    if (page_kb <= 0) page_kb = 4;
+
+    struct timespec last = {0, 0};
+    char buf[4096];
+    if (write(STDOUT_FILENO, "\033[?25l", 6) < 0) { /* hide cursor */ }
+    while (!stop && iterations != 0) {
+        int rows = 24, cols = 80;
+        struct winsize ws;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+            rows = ws.ws_row;
+            cols = ws.ws_col;
+        }
+        if (rows > MAX_LINES) rows = MAX_LINES;
+        if (cols > LINE_W - 1) cols = LINE_W - 1;
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double dt = last.tv_sec ? (double)(now.tv_sec - last.tv_sec) + (double)(now.tv_nsec - last.tv_nsec) / 1e9 : 0;
+        last = now;
+
+        if (refresh_procs(procfd, page_kb, hz, dt) < 0) {
+            perror("top_lite");
+            break;
+        }
+        read_cpus(statfd);
+
+        int n = 0;
+        unsigned long long up = 0;
+        if (upfd >= 0 && pread_all(upfd, buf, sizeof(buf)) > 0) up = uptime_ticks(buf, hz) / (unsigned long long)hz;
+        char upstr[32], load[64] = "?";
+        fmt_secs(upstr, sizeof(upstr), up);
+        if (loadfd >= 0 && pread_all(loadfd, buf, sizeof(buf)) > 0) {
+            char *sp = buf;
+            for (int k = 0; k < 3 && sp; k++) sp = strchr(sp + 1, ' ');
+            if (sp) *sp = '\0';
+            snprintf(load, sizeof(load), "%.63s", buf);
+        }
+        snprintf(line(n++), LINE_W, "top_lite - up %s, load average: %s", upstr, load);
+
+        unsigned long long mtotal = 0, mavail = 0, mfree = 0;
+        if (memfd >= 0 && pread_all(memfd, buf, sizeof(buf)) > 0) {
+            mtotal = meminfo_value(buf, "MemTotal");
+            mfree = meminfo_value(buf, "MemFree");
+            mavail = meminfo_value(buf, "MemAvailable");
+            if (!mavail) mavail = mfree;
+        }
+        snprintf(line(n++), LINE_W, "Tasks: %zu total, %u running   Mem: %llu MB total, %llu MB used, %llu MB avail",
+                 nprocs, procs_running, mtotal / 1024, (mtotal - mavail) / 1024, mavail / 1024);
+
+        /* overall CPU, then four per-CPU columns per line */
+        snprintf(line(n++), LINE_W, "CPU: %5.1f%% busy (%d cpus)", cpu_pct(0), ncpus);
+        for (int c = 1; c <= ncpus && n < rows - 3; ) {
+            char *l = line(n++);
+            size_t off = 0;
+            for (int k = 0; k < 4 && c <= ncpus; k++, c++)
+                off += (size_t)snprintf(l + off, LINE_W - off, "cpu%-3d %5.1f%%   ", c - 1, cpu_pct(c));
+        }
+        memcpy(cpu_prev, cpu_cur, sizeof(cpu_prev));
+
+        snprintf(line(n++), LINE_W, " ");
+        snprintf(line(n++), LINE_W, "  PID S  %%CPU    RSS(KB)  CMD");
+        for (size_t k = 0; k < nprocs; k++) order[k] = &procs[k];
+        qsort(order, nprocs, sizeof(*order), proc_cmp);
+        for (size_t k = 0; k < nprocs && n < rows - 1; k++) {
+            const struct tproc *t = order[k];
+            snprintf(line(n++), LINE_W, "%5d %c %5.1f %10lu  %s", t->pid, t->row.state, t->cpu, t->row.rss_kb, t->row.comm);
+        }
+        flush_frame(n, cols);
+
+        if (iterations > 0) iterations--;
+        if (stop || iterations == 0) break;
+        struct timespec ts = { (time_t)delay, (long)((delay - (double)(time_t)delay) * 1e9) };
+        while (nanosleep(&ts, &ts) < 0 && errno == EINTR && !stop) {}
+    }
+    if (write(STDOUT_FILENO, "\033[?25h\n", 7) < 0) { /* show cursor again */ }
+    reset_state();
+    int fds[] = { upfd, loadfd, memfd, statfd, procfd };
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) if (fds[i] >= 0) close(fds[i]);
+    if (raised) setrlimit(RLIMIT_NOFILE, &saved_rl);
+    return 0;
+}
+
+#ifndef SOLIX_MULTICALL
+int main(int argc, char *argv[]) {
+    return top_lite_main(argc, argv);
+}
+#endif
@@ -1,7 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "applets.h"
 
-int main(void) {
+int uptime_lite_main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
     FILE *f = fopen("/proc/uptime", "r");
     if (!f) {
         perror("/proc/uptime");
@@ -27,4 +30,8 @@ int main(void) {
     return 0;
 }
 
-
+#ifndef SOLIX_MULTICALL
+int main(int argc, char *argv[]) {
+    return uptime_lite_main(argc, argv);
+}
+#endif
@@ -0,0 +1,153 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Solix: host-side microbenchmarks of the custom shell
+# - Each workload runs RUNS times against a host build of rootfs/shell/shell.c
+# - Raw rows:  build/bench-shell/results.tsv  "bench<TAB>run<TAB>value<TAB>unit"
+# - Summary:   build/bench-shell/summary.tsv  "bench<TAB>unit<TAB>n<TAB>min<TAB>p50<TAB>max"
+# - History:   build/bench-shell/history.tsv  "commit<TAB>date<TAB>bench<TAB>unit<TAB>p50",
+#   one block per invocation, to compare commits
+# Units: *_us / *_ms lower is better, *_mbps higher is better
+#
+# Usage: bench-shell.sh [runs]
+# Env:   BENCH_BIN (shell binary), BENCH_MB (data size, default 256), BENCH_LS_ENTRIES (default 100000)
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="${ROOT_DIR}/build"
+OUT_DIR="${BUILD_DIR}/bench-shell"
+WORK="${OUT_DIR}/work"
+
+BIN="${BENCH_BIN:-${OUT_DIR}/shell}"
+RUNS="${1:-${RUNS:-5}}"
+MB="${BENCH_MB:-256}"
+LS_ENTRIES="${BENCH_LS_ENTRIES:-100000}"
+
+RESULTS="${OUT_DIR}/results.tsv"
+SUMMARY="${OUT_DIR}/summary.tsv"
+HISTORY="${OUT_DIR}/history.tsv"
+
+export LC_ALL=C
+[[ -x "${BIN}" ]] || { echo "[bench-shell] missing ${BIN}; run make bench-shell" >&2; exit 1; }
+CAT_BIN="$(command -v cat)"
+
+mkdir -p "${WORK}"
+: > "${RESULTS}"
+
+# Microseconds since the epoch, without forking (bash 5 EPOCHREALTIME)
+now_us() { local t="${EPOCHREALTIME/./}"; printf -v "$1" '%d' "$((10#${t}))"; }
+
+row() { printf '%s\t%d\t%s\t%s\n' "$1" "$2" "$3" "$4" >> "${RESULTS}"; }
+
+# time_cmd var [-o file] cmd...: elapsed microseconds of cmd; stdout to file
+# (default /dev/null)
+time_cmd() {
+  local __t0 __t1 __var="$1" __out=/dev/null; shift
+  if [[ "$1" == "-o" ]]; then __out="$2"; shift 2; fi
+  now_us __t0
+  "$@" > "${__out}"
+  now_us __t1
+  printf -v "${__var}" '%d' "$((__t1 - __t0))"
+}
+
+per_op() { awk -v us="$1" -v n="$2" -v div="$3" 'BEGIN { printf "%.3f", us / n / div }'; }
+mbps() { awk -v bytes="$1" -v us="$2" 'BEGIN { printf "%.1f", bytes / us }'; }
+
+# --- Workloads (generated once per invocation) ---
+
+# 2000 distinct ~4 KB lines of words, quotes and operators for the lexer;
+# unset of names that are not set does almost no work after parsing
+awk 'BEGIN {
+  for (i = 0; i < 2000; i++) {
+    line = "unset"
+    for (k = 0; length(line) < 4000; k++) line = line sprintf(" v%d_%d '\''q %d'\'' \"a|b%d\" c\\;d%d", i, k, k, k, k)
+    print line " ; unset x" i " && unset y" i " || unset z" i
+  }
+}' > "${WORK}/tokenize.sh"
+# the same line 2000 times: parse cache hits
+head -n 1 "${WORK}/tokenize.sh" | awk '{ for (i = 0; i < 2000; i++) print }' > "${WORK}/tokenize-cached.sh"
+TOK_BYTES=$(stat -c %s "${WORK}/tokenize.sh")
+
+SPAWN_N=1000
+PIPE_N=300
+awk -v n="${SPAWN_N}" 'BEGIN { for (i = 0; i < n; i++) print "true" }' > "${WORK}/spawn.sh"
+{ echo "set +o spawn"; cat "${WORK}/spawn.sh"; } > "${WORK}/spawn-fork.sh"
+awk -v n="${PIPE_N}" 'BEGIN { for (i = 0; i < n; i++) print "true | true" }' > "${WORK}/pipe2.sh"
+awk -v n="${PIPE_N}" 'BEGIN { for (i = 0; i < n; i++) print "true | true | true | true | true | true | true | true" }' > "${WORK}/pipe8.sh"
+
+BYTES=$((MB * 1024 * 1024))
+[[ "$(stat -c %s "${WORK}/data" 2>/dev/null || echo 0)" == "${BYTES}" ]] || head -c "${BYTES}" /dev/urandom > "${WORK}/data"
+CATS7=""
+for ((k = 0; k < 7; k++)); do CATS7="${CATS7} | ${CAT_BIN}"; done
+
+# 100k entries take a while to create: kept between invocations
+LS_DIR="${WORK}/ls-${LS_ENTRIES}"
+if [[ "$(cat "${LS_DIR}.count" 2>/dev/null)" != "${LS_ENTRIES}" ]]; then
+  echo "[bench-shell] creating ${LS_ENTRIES} entries in ${LS_DIR}"
+  rm -rf "${LS_DIR}"; mkdir -p "${LS_DIR}"
+  (cd "${LS_DIR}" && seq -f "f%06g" "${LS_ENTRIES}" | xargs touch)
+  echo "${LS_ENTRIES}" > "${LS_DIR}.count"
+fi
+
+# Startup: empty history vs a history file at its compaction size (64 KB)
+mkdir -p "${WORK}/home-empty" "${WORK}/home-full"
+awk 'BEGIN { for (i = 0; length(s) < 64000; i++) s = s sprintf("echo history line %06d with a few words | tr a b\n", i); printf "%s", s }' \
+  > "${WORK}/home-full/.solix_history"
+: > "${WORK}/home-empty/.solix_history"
+# interactive mode (loads history); stdin at EOF, so it exits straight away
+# and leaves the file as it was
+STARTUP_N=100
+startup() {
+  local i
+  for ((i = 0; i < STARTUP_N; i++)); do
+    HOME="$1" "${BIN}" < /dev/null 2>/dev/null
+  done
+}
+
+echo "[bench-shell] ${BIN}: ${RUNS} runs per workload"
+for ((run = 1; run <= RUNS; run++)); do
+  time_cmd us "${BIN}" "${WORK}/tokenize.sh";          row tokenize_mbps "${run}" "$(mbps "${TOK_BYTES}" "${us}")" MB/s
+  time_cmd us "${BIN}" "${WORK}/tokenize-cached.sh";   row tokenize_cached_mbps "${run}" "$(mbps "${TOK_BYTES}" "${us}")" MB/s
+  time_cmd us "${BIN}" "${WORK}/spawn.sh";             row spawn_true_us "${run}" "$(per_op "${us}" "${SPAWN_N}" 1)" us
+  time_cmd us "${BIN}" "${WORK}/spawn-fork.sh";        row spawn_true_fork_us "${run}" "$(per_op "${us}" "${SPAWN_N}" 1)" us
+  time_cmd us "${BIN}" "${WORK}/pipe2.sh";             row pipe2_setup_us "${run}" "$(per_op "${us}" "${PIPE_N}" 1)" us
+  time_cmd us "${BIN}" "${WORK}/pipe8.sh";             row pipe8_setup_us "${run}" "$(per_op "${us}" "${PIPE_N}" 1)" us
+  time_cmd us "${BIN}" -c "${CAT_BIN} ${WORK}/data | ${CAT_BIN} > /dev/null"; row pipe2_mbps "${run}" "$(mbps "${BYTES}" "${us}")" MB/s
+  time_cmd us "${BIN}" -c "${CAT_BIN} ${WORK}/data${CATS7} > /dev/null";     row pipe8_mbps "${run}" "$(mbps "${BYTES}" "${us}")" MB/s
+  rm -f "${WORK}/cat.out"
+  time_cmd us -o "${WORK}/cat.out" "${BIN}" -c "cat ${WORK}/data"          # builtin, file to file
+  row cat_file_mbps "${run}" "$(mbps "${BYTES}" "${us}")" MB/s
+  time_cmd us bash -c "\"${BIN}\" -c \"cat ${WORK}/data\" | \"${CAT_BIN}\" > /dev/null"  # builtin, file to pipe
+  row cat_pipe_mbps "${run}" "$(mbps "${BYTES}" "${us}")" MB/s
+  time_cmd us "${BIN}" -c "ls ${LS_DIR}";              row ls_100k_ms "${run}" "$(per_op "${us}" 1 1000)" ms
+  time_cmd us "${BIN}" -c "ls -l ${LS_DIR}";           row ls_l_100k_ms "${run}" "$(per_op "${us}" 1 1000)" ms
+  time_cmd us startup "${WORK}/home-empty";            row startup_ms "${run}" "$(per_op "${us}" "${STARTUP_N}" 1000)" ms
+  time_cmd us startup "${WORK}/home-full";             row startup_full_history_ms "${run}" "$(per_op "${us}" "${STARTUP_N}" 1000)" ms
+done
+rm -f "${WORK}/cat.out"
+
+# min / nearest-rank p50 / max per bench, in first-seen order
+awk -F'\t' '
+  !($1 in n) { order[++m] = $1; unit[$1] = $4 }
+  { v[$1, ++n[$1]] = $3 + 0 }
+  END {
+    for (j = 1; j <= m; j++) {
+      k = order[j]
+      for (a = 2; a <= n[k]; a++) {
+        x = v[k, a]
+        for (b = a - 1; b >= 1 && v[k, b] > x; b--) v[k, b + 1] = v[k, b]
+        v[k, b + 1] = x
+      }
+      mid = int(0.5 * n[k] + 0.999999); if (mid < 1) mid = 1
+      printf "%s\t%s\t%d\t%.3f\t%.3f\t%.3f\n", k, unit[k], n[k], v[k, 1], v[k, mid], v[k, n[k]]
+    }
+  }
+' "${RESULTS}" > "${SUMMARY}"
+
+COMMIT="$(git -C "${ROOT_DIR}" describe --always --dirty 2>/dev/null || echo unknown)"
+DATE="$(date -u +%Y-%m-%dT%H:%M:%SZ)"
+awk -F'\t' -v c="${COMMIT}" -v d="${DATE}" '{ printf "%s\t%s\t%s\t%s\t%s\n", c, d, $1, $2, $5 }' "${SUMMARY}" >> "${HISTORY}"
+
+printf '\n%-26s %6s %4s %12s %12s %12s\n' "bench (${COMMIT})" unit n min p50 max
+awk -F'\t' '{ printf "%-26s %6s %4d %12.3f %12.3f %12.3f\n", $1, $2, $3, $4, $5, $6 }' "${SUMMARY}"
+echo
+echo "[bench-shell] raw rows in ${RESULTS}, summary in ${SUMMARY}, per-commit p50s in ${HISTORY}"
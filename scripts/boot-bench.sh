@@ -0,0 +1,153 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Solix: boot kernel + initramfs N times under QEMU and report boot-phase percentiles
+# - Uses KVM when /dev/kvm is usable, TCG otherwise
+# - Boots with solix.timing so rcS copies its boot marks to the serial console
+#   as "[solix-timing] event<TAB>name<TAB>uptime" lines; a run ends at the shell mark
+# - printk.time=1 lets rcS also report the kernel's initramfs unpack window
+#
+# - Several kernels (KERNELS="a b") are benchmarked in turn and compared
+#
+# Usage: boot-bench.sh [runs]
+# Env:   KERNELS (or KERNEL), INITRD, QEMU, MEM, TIMEOUT (seconds per boot), APPEND (extra cmdline)
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="${ROOT_DIR}/build"
+
+read -r -a KERNEL_LIST <<< "${KERNELS:-${KERNEL:-${BUILD_DIR}/boot/vmlinuz}}"
+INITRD="${INITRD:-${BUILD_DIR}/initramfs.img}"
+RUNS="${1:-${RUNS:-10}}"
+QEMU="${QEMU:-qemu-system-x86_64}"
+MEM="${MEM:-512M}"
+TIMEOUT="${TIMEOUT:-60}"
+APPEND="${APPEND:-}"
+
+OUT_DIR="${BUILD_DIR}/boot-bench"
+RESULTS="${OUT_DIR}/results.tsv"
+SUMMARY="${OUT_DIR}/summary.tsv"
+
+for f in "${KERNEL_LIST[@]}" "${INITRD}"; do
+  [[ -f "${f}" ]] || { echo "[boot-bench] missing ${f}; run make initramfs first" >&2; exit 1; }
+done
+command -v "${QEMU}" >/dev/null 2>&1 || { echo "[boot-bench] ${QEMU} not found" >&2; exit 1; }
+
+if [[ -r /dev/kvm && -w /dev/kvm ]]; then
+  ACCEL=(-enable-kvm -cpu host)
+  ACCEL_NAME="kvm"
+else
+  ACCEL=(-cpu max)
+  ACCEL_NAME="tcg"
+fi
+
+mkdir -p "${OUT_DIR}"
+: > "${RESULTS}"
+
+# Turn one serial log into "kernel<TAB>run<TAB>metric<TAB>seconds" rows
+extract() {
+  awk -v run="${KNAME}"$'\t'"$1" -v host_ms="$2" '
+    { sub(/\r$/, "") }
+    /^\[solix-timing\] / {
+      sub(/^\[solix-timing\] /, "")
+      split($0, f, "\t")
+      ev = f[1]; name = f[2]; t = f[3] + 0
+      if (ev == "init") { init = t; printf "%s\tkernel_to_init\t%.3f\n", run, t }
+      else if (ev == "rcS" && !rcs++) { if (init != "") printf "%s\tinit_to_rcS\t%.3f\n", run, t - init }
+      else if (ev == "start") start[name] = t
+      else if (ev == "end" && (name in start)) printf "%s\tstage.%s\t%.3f\n", run, name, t - start[name]
+      else if (ev == "unpack_start") unpack = t
+      else if (ev == "unpack_end" && unpack != "") printf "%s\tinitramfs_unpack\t%.3f\n", run, t - unpack
+      else if (ev == "handoff") printf "%s\tkernel_to_handoff\t%.3f\n", run, t
+      else if (ev == "shell") printf "%s\ttime_to_prompt\t%.3f\n", run, t
+    }
+    END { printf "%s\thost_wall_to_prompt\t%.3f\n", run, host_ms / 1000 }
+  ' "$3"
+}
+
+run_once() {
+  local run="$1" log="${OUT_DIR}/boot-${KNAME}-$1.log"
+  local start_ns deadline pid
+  start_ns=$(date +%s%N)
+  "${QEMU}" "${ACCEL[@]}" -m "${MEM}" -nographic -no-reboot \
+    -kernel "${KPATH}" -initrd "${INITRD}" \
+    -append "console=ttyS0 quiet printk.time=1 solix.timing ${APPEND}" </dev/null >"${log}" 2>&1 &
+  pid=$!
+  deadline=$((SECONDS + TIMEOUT))
+  until grep -q '^\[solix-timing\] shell' "${log}"; do
+    if ! kill -0 "${pid}" 2>/dev/null || (( SECONDS >= deadline )); then
+      kill "${pid}" 2>/dev/null || true
+      wait "${pid}" 2>/dev/null || true
+      echo "[boot-bench] run ${run}: no shell mark (see ${log})" >&2
+      return 1
+    fi
+    sleep 0.05
+  done
+  local host_ms=$(( ($(date +%s%N) - start_ns) / 1000000 ))
+  kill "${pid}" 2>/dev/null || true
+  wait "${pid}" 2>/dev/null || true
+  extract "${run}" "${host_ms}" "${log}" >> "${RESULTS}"
+}
+
+# Compression of the initramfs, from its magic bytes
+initrd_comp() {
+  case "$(od -An -tx1 -N4 "${INITRD}" | tr -d ' \n')" in
+    1f8b*) echo gzip ;;
+    28b52ffd) echo zstd ;;
+    02214c18) echo lz4 ;;
+    303730*) echo none ;;
+    *) echo unknown ;;
+  esac
+}
+
+echo "[boot-bench] ${RUNS} boots per kernel + $(basename "${INITRD}") (${ACCEL_NAME})"
+echo "[boot-bench] initramfs: $(stat -c %s "${INITRD}") bytes, $(initrd_comp)"
+for KPATH in "${KERNEL_LIST[@]}"; do
+  KNAME="$(basename "$(readlink -f "${KPATH}")")"
+  ok=0
+  for ((i = 1; i <= RUNS; i++)); do
+    run_once "${i}" && ok=$((ok + 1))
+  done
+  echo "[boot-bench] ${KNAME}: ${ok}/${RUNS} boots ok"
+done
+[[ -s "${RESULTS}" ]] || { echo "[boot-bench] no successful boots" >&2; exit 1; }
+
+# Nearest-rank percentiles per kernel and metric, in first-seen order:
+# "kernel<TAB>metric<TAB>n<TAB>min<TAB>p50<TAB>p90<TAB>max"
+awk -F'\t' '
+  { key = $1 "\t" $3 }
+  !(key in n) { order[++m] = key }
+  { v[key, ++n[key]] = $4 + 0 }
+  function pct(k, p,   i) { i = int(p * n[k] + 0.999999); if (i < 1) i = 1; return v[k, i] }
+  END {
+    for (j = 1; j <= m; j++) {
+      k = order[j]
+      for (a = 2; a <= n[k]; a++) {          # insertion sort: n is the run count
+        x = v[k, a]
+        for (b = a - 1; b >= 1 && v[k, b] > x; b--) v[k, b + 1] = v[k, b]
+        v[k, b + 1] = x
+      }
+      printf "%s\t%d\t%.3f\t%.3f\t%.3f\t%.3f\n", k, n[k], v[k, 1], pct(k, 0.5), pct(k, 0.9), v[k, n[k]]
+    }
+  }
+' "${RESULTS}" > "${SUMMARY}"
+
+awk -F'\t' '
+  $1 != last { printf "\n%s\n%-28s %4s %8s %8s %8s %8s\n", $1, "metric (s)", "n", "min", "p50", "p90", "max"; last = $1 }
+  { printf "%-28s %4d %8.3f %8.3f %8.3f %8.3f\n", $2, $3, $4, $5, $6, $7 }
+' "${SUMMARY}"
+
+# Several kernels: headline p50s side by side
+if (( ${#KERNEL_LIST[@]} > 1 )); then
+  awk -F'\t' '
+    !($1 in seen) { seen[$1] = 1; kern[++nk] = $1 }
+    $2 == "kernel_to_init" || $2 == "initramfs_unpack" || $2 == "time_to_prompt" { p50[$1, $2] = $5 }
+    function get(k, m) { return ((k, m) in p50) ? p50[k, m] : "-" }
+    END {
+      printf "\n%-36s %14s %16s %14s\n", "p50 (s)", "kernel_to_init", "initramfs_unpack", "time_to_prompt"
+      for (i = 1; i <= nk; i++)
+        printf "%-36s %14s %16s %14s\n", kern[i], get(kern[i], "kernel_to_init"), get(kern[i], "initramfs_unpack"), get(kern[i], "time_to_prompt")
+    }
+  ' "${SUMMARY}"
+fi
+echo
+echo "[boot-bench] raw rows in ${RESULTS}, percentiles in ${SUMMARY}"
@@ -2,8 +2,12 @@
 set -euo pipefail
 
 # Solix: Create/populate persistent ext4 root filesystem image
-# - Idempotent: safe to re-run
-# - Tries to mount to populate; if mount not possible, image will be populated on first boot by initramfs
+# - No mounts and no root: the tree is staged in build/rootfs-stage and
+#   written into a sparse image in one pass by mke2fs -d (e2fsprogs >= 1.43)
+# - Idempotent: an unchanged tree keeps the existing image; a changed tree
+#   rebuilds it unless the image was booted since (FORCE=1 to rebuild anyway)
+#
+# Env: IMG_SIZE_MB (default 128, allocated lazily), FORCE, SOURCE_DATE_EPOCH
 
 ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
 BUILD_DIR="${ROOT_DIR}/build"
@@ -11,79 +15,47 @@ BUSYBOX_INSTALL="${ROOT_DIR}/busybox/_install"
 ROOTFS_SRC="${ROOT_DIR}/rootfs"
 
 IMG_PATH="${BUILD_DIR}/rootfs.img"
-IMG_SIZE_MB="128"
-MNT_DIR="${BUILD_DIR}/mnt-rootfs"
+IMG_SIZE_MB="${IMG_SIZE_MB:-128}"
+STAGE_DIR="${BUILD_DIR}/rootfs-stage"
+# Hash of the staged tree the image was built from
+TREE_STAMP="${IMG_PATH}.tree"
+SOURCE_DATE_EPOCH="${SOURCE_DATE_EPOCH:-0}"
 
 mkdir -p "${BUILD_DIR}"
 
-create_img() {
-  if [[ -f "${IMG_PATH}" ]]; then
-    echo "[mkrootfs] Using existing image: ${IMG_PATH}"
-    return
-  fi
-  echo "[mkrootfs] Creating ${IMG_SIZE_MB}MB ext4 image at ${IMG_PATH}"
-  dd if=/dev/zero of="${IMG_PATH}" bs=1M count="${IMG_SIZE_MB}" status=none
-  mkfs.ext4 -F -L SOLIX_ROOT "${IMG_PATH}" >/dev/null
-}
+stage_tree() {
+  echo "[mkrootfs] Staging rootfs tree in ${STAGE_DIR}"
+  rm -rf "${STAGE_DIR}"
+  mkdir -p "${STAGE_DIR}"
 
-try_mount_guest() {
-  if command -v guestmount >/dev/null 2>&1; then
-    echo "[mkrootfs] Mounting with guestmount..."
-    mkdir -p "${MNT_DIR}"
-    guestmount -a "${IMG_PATH}" -m /dev/sda1 --pid-file "${BUILD_DIR}/guestmount.pid" "${MNT_DIR}" || return 1
-    echo guest >"${MNT_DIR}/.solix_mount_method"
-    return 0
-  fi
-  return 1
-}
-
-try_mount_loop() {
-  if [[ $EUID -ne 0 ]]; then
-    echo "[mkrootfs] Not root; will try sudo for loop mount"
-  fi
-  mkdir -p "${MNT_DIR}"
-  # Setup loop device
-  local loopdev
-  loopdev=$(sudo losetup -P -f --show "${IMG_PATH}") || return 1
-  trap 'sudo losetup -d "${loopdev}" >/dev/null 2>&1 || true' EXIT
-  echo "[mkrootfs] Loop device: ${loopdev}"
-  sudo mount -t ext4 "${loopdev}" "${MNT_DIR}" || sudo mount -t ext4 "${loopdev}p1" "${MNT_DIR}" || return 1
-  echo loop >"${MNT_DIR}/.solix_mount_method"
-  return 0
-}
-
-populate_tree() {
-  echo "[mkrootfs] Populating rootfs tree..."
-  install -d -m 0755 "${MNT_DIR}"/{bin,sbin,etc,proc,sys,dev,run,tmp,usr/bin,usr/sbin,root,home,var/log}
-
-  # Install BusyBox and applets into target root (symlinks)
+  # BusyBox with its applet symlinks, as installed by make busybox
   if [[ -x "${BUSYBOX_INSTALL}/bin/busybox" ]]; then
-    install -D -m 0755 "${BUSYBOX_INSTALL}/bin/busybox" "${MNT_DIR}/bin/busybox"
-    chroot "${MNT_DIR}" /bin/busybox --install -s /
-    ln -sf /bin/busybox "${MNT_DIR}/bin/sh"
+    rsync -a "${BUSYBOX_INSTALL}/" "${STAGE_DIR}/"
+    ln -sf /bin/busybox "${STAGE_DIR}/bin/sh"
   else
     echo "[mkrootfs] WARNING: BusyBox not built yet; initramfs will populate on first boot"
   fi
+  install -d -m 0755 "${STAGE_DIR}"/{bin,sbin,etc,proc,sys,dev,run,tmp,usr/bin,usr/sbin,root,home,var/log}
+  chmod 1777 "${STAGE_DIR}/tmp"
 
   # Install custom shell and utilities from build
+  # (the utilities are applets of the shell binary, reached via symlinks)
   if [[ -x "${BUILD_DIR}/rootfs/bin/shell" ]]; then
-    install -D -m 0755 "${BUILD_DIR}/rootfs/bin/shell" "${MNT_DIR}/bin/shell"
+    install -D -m 0755 "${BUILD_DIR}/rootfs/bin/shell" "${STAGE_DIR}/bin/shell"
+    for u in uptime_lite ps_lite meminfo_lite top_lite; do
+      ln -sf shell "${STAGE_DIR}/bin/${u}"
+    done
   fi
-  for u in uptime_lite ps_lite meminfo_lite; do
-    if [[ -x "${BUILD_DIR}/rootfs/bin/${u}" ]]; then
-      install -D -m 0755 "${BUILD_DIR}/rootfs/bin/${u}" "${MNT_DIR}/bin/${u}"
-    fi
-  done
 
   # Base configs: inittab, rcS, passwd, shadow, network.up, hostname, hosts
-  install -d -m 0755 "${MNT_DIR}/etc/init.d"
+  install -d -m 0755 "${STAGE_DIR}/etc/init.d"
   if [[ -f "${ROOTFS_SRC}/etc/init.d/rcS" ]]; then
-    install -m 0755 "${ROOTFS_SRC}/etc/init.d/rcS" "${MNT_DIR}/etc/init.d/rcS"
+    install -m 0755 "${ROOTFS_SRC}/etc/init.d/rcS" "${STAGE_DIR}/etc/init.d/rcS"
   fi
   if [[ -f "${ROOTFS_SRC}/etc/inittab" ]]; then
-    install -m 0644 "${ROOTFS_SRC}/etc/inittab" "${MNT_DIR}/etc/inittab"
+    install -m 0644 "${ROOTFS_SRC}/etc/inittab" "${STAGE_DIR}/etc/inittab"
   else
-    cat >"${MNT_DIR}/etc/inittab" <<'EOF'
+    cat >"${STAGE_DIR}/etc/inittab" <<'EOF'
 ::sysinit:/etc/init.d/rcS
 ttyS0::respawn:/sbin/getty -L ttyS0 115200 vt100
 tty1::respawn:/sbin/getty tty1 9600
@@ -91,49 +63,87 @@ tty1::respawn:/sbin/getty tty1 9600
 ::shutdown:/bin/umount -a -r
 EOF
   fi
-  if [[ -f "${ROOTFS_SRC}/etc/network.up" ]]; then
-    install -m 0755 "${ROOTFS_SRC}/etc/network.up" "${MNT_DIR}/etc/network.up"
-  fi
+  for f in network.up udhcpc.script; do
+    if [[ -f "${ROOTFS_SRC}/etc/${f}" ]]; then
+      install -m 0755 "${ROOTFS_SRC}/etc/${f}" "${STAGE_DIR}/etc/${f}"
+    fi
+  done
 
-  echo solix >"${MNT_DIR}/etc/hostname"
-  cat >"${MNT_DIR}/etc/hosts" <<'EOF'
+  echo solix >"${STAGE_DIR}/etc/hostname"
+  cat >"${STAGE_DIR}/etc/hosts" <<'EOF'
 127.0.0.1   localhost solix
 ::1         localhost solix
 EOF
 
   # Root user (no password, demo only)
-  echo 'root::0:0:root:/root:/bin/sh' >"${MNT_DIR}/etc/passwd"
-  echo 'root::19700:0:99999:7:::' >"${MNT_DIR}/etc/shadow"
-  chmod 0600 "${MNT_DIR}/etc/shadow"
+  echo 'root::0:0:root:/root:/bin/sh' >"${STAGE_DIR}/etc/passwd"
+  echo 'root::19700:0:99999:7:::' >"${STAGE_DIR}/etc/shadow"
+  chmod 0600 "${STAGE_DIR}/etc/shadow"
 
   # Secure ttys for root
-  printf "ttyS0\ntty1\nconsole\n" >"${MNT_DIR}/etc/securetty"
+  printf "ttyS0\ntty1\nconsole\n" >"${STAGE_DIR}/etc/securetty"
 
-  echo "[mkrootfs] Population complete"
+  # Fixed mtimes, so mke2fs -d sees the same tree for the same inputs
+  find "${STAGE_DIR}" -exec touch -h -d "@${SOURCE_DATE_EPOCH}" {} +
 }
 
-unmount_any() {
-  if mountpoint -q "${MNT_DIR}"; then
-    echo "[mkrootfs] Unmounting ${MNT_DIR}"
-    if [[ -f "${MNT_DIR}/.solix_mount_method" ]] && grep -q guest "${MNT_DIR}/.solix_mount_method" 2>/dev/null; then
-      guestunmount "${MNT_DIR}" || true
-    else
-      sudo umount "${MNT_DIR}" || true
-    fi
+tree_hash() {
+  cd "${STAGE_DIR}"
+  {
+    find . -printf '%P\t%y\t%m\t%l\n' | LC_ALL=C sort
+    find . -type f -print0 | LC_ALL=C sort -z | xargs -0 -r sha256sum
+    echo "${IMG_SIZE_MB}"
+  } | sha256sum | cut -d' ' -f1
+}
+
+# Small, mostly read-only root:
+# - lazy_itable_init=0/lazy_journal_init=0: inode tables and journal are
+#   zeroed here, so the kernel starts no ext4lazyinit thread on first boot
+#   (on a sparse file the inode tables are zeroed by punching holes)
+# - a 4 MB journal and one inode per 16k: a root that is rarely written
+#   needs neither, and each is real allocated space in the image
+# - 4k blocks and no reserved blocks; root_owner keeps / at 0:0
+# - commit=60 stored as a default mount option (noatime is set by rcS,
+#   the superblock option string only takes ext4 options)
+build_img() {
+  echo "[mkrootfs] Creating ${IMG_SIZE_MB}MB sparse ext4 image at ${IMG_PATH}"
+  rm -f "${IMG_PATH}.new"
+  truncate -s "${IMG_SIZE_MB}M" "${IMG_PATH}.new"
+  mke2fs -q -F -t ext4 -L SOLIX_ROOT -b 4096 -m 0 -i 16384 -J size=4 \
+    -E lazy_itable_init=0,lazy_journal_init=0,root_owner=0:0 \
+    -d "${STAGE_DIR}" "${IMG_PATH}.new"
+  tune2fs -E mount_opts=commit=60 "${IMG_PATH}.new" >/dev/null
+
+  # Not root: the staged files carry our uid, hand everything to root
+  if [[ $EUID -ne 0 ]]; then
+    (cd "${STAGE_DIR}" && find . -mindepth 1 -printf '%P\n') |
+      awk '{ printf "sif \"/%s\" uid 0\nsif \"/%s\" gid 0\n", $0, $0 }' |
+      debugfs -w -f - "${IMG_PATH}.new" >/dev/null 2>&1
   fi
+  e2fsck -fn "${IMG_PATH}.new" >/dev/null 2>&1
+  mv "${IMG_PATH}.new" "${IMG_PATH}"
 }
 
 main() {
-  create_img
-
-  if try_mount_guest || try_mount_loop; then
-    trap unmount_any EXIT
-    populate_tree
-  else
-    echo "[mkrootfs] NOTE: Could not mount image; it will be auto-populated on first boot by initramfs."
+  command -v mke2fs >/dev/null 2>&1 || { echo "[mkrootfs] mke2fs (e2fsprogs) not found" >&2; exit 1; }
+  stage_tree
+  local hash
+  hash="$(tree_hash)"
+
+  if [[ -f "${IMG_PATH}" && -z "${FORCE:-}" ]]; then
+    if [[ "$(cat "${TREE_STAMP}" 2>/dev/null)" == "${hash}" ]]; then
+      echo "[mkrootfs] Rootfs unchanged: ${IMG_PATH}"
+      return
+    fi
+    if [[ ! -f "${TREE_STAMP}" || "${IMG_PATH}" -nt "${TREE_STAMP}" ]]; then
+      echo "[mkrootfs] NOTE: ${IMG_PATH} has been used since it was built; keeping it (FORCE=1 to rebuild)"
+      return
+    fi
   fi
+
+  build_img
+  echo "${hash}" >"${TREE_STAMP}"
+  echo "[mkrootfs] Created ${IMG_PATH}: $(du -k "${IMG_PATH}" | cut -f1)K allocated of ${IMG_SIZE_MB}M"
 }
 
 main "$@"
-
-